@@ -0,0 +1,197 @@
+#include "Harness.h"
+#include "osm.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <sched.h>
+
+#define SUCCESS 0
+#define FAILURE (-1)
+#define NO_PIN (-1)
+#define DEFAULT_WARMUP 10
+#define DEFAULT_TRIALS 100
+#define DEFAULT_CONFIDENCE 0.95
+#define OUTLIER_MADS 3.5
+#define MAD_TO_STDDEV 1.4826
+#define P90 0.90
+#define P99 0.99
+#define Z_90 1.645
+#define Z_95 1.960
+#define Z_99 2.576
+#define EPSILON 1e-9
+
+using namespace std;
+
+HarnessConfig default_harness_config ()
+{
+  HarnessConfig config{};
+  config.warmup_rounds = DEFAULT_WARMUP;
+  config.trials = DEFAULT_TRIALS;
+  config.cpu = NO_PIN;
+  config.reject_outliers = false;
+  config.confidence = DEFAULT_CONFIDENCE;
+  return config;
+}
+
+/**
+ * returns the q quantile of a sorted vector, interpolating between neighbours.
+ * @param sorted the sorted samples
+ * @param q the quantile, between 0 and 1
+ * @return the quantile value
+ */
+static double quantile (const vector<double> &sorted, double q)
+{
+  double pos = q * (sorted.size () - 1);
+  size_t low = (size_t) pos;
+  size_t high = min (low + 1, sorted.size () - 1);
+  return sorted[low] + (pos - low) * (sorted[high] - sorted[low]);
+}
+
+/**
+ * returns the z score of a two sided confidence interval.
+ * @param confidence the confidence level
+ * @return the z score, the 95% one for unsupported levels
+ */
+static double z_score (double confidence)
+{
+  if (fabs (confidence - P90) < EPSILON)
+    {
+      return Z_90;
+    }
+  if (fabs (confidence - P99) < EPSILON)
+    {
+      return Z_99;
+    }
+  return Z_95;
+}
+
+/**
+ * drops the samples further than OUTLIER_MADS median absolute deviations from the median.
+ * @param sorted the sorted samples, stays sorted
+ * @return the number of dropped samples
+ */
+static unsigned int reject_outliers (vector<double> &sorted)
+{
+  double median = quantile (sorted, 0.5);
+  vector<double> deviations;
+  for (double sample : sorted)
+    {
+      deviations.push_back (fabs (sample - median));
+    }
+  sort (deviations.begin (), deviations.end ());
+  double limit = OUTLIER_MADS * MAD_TO_STDDEV * quantile (deviations, 0.5);
+  if (limit <= 0)
+    {
+      return 0;
+    }
+  size_t before = sorted.size ();
+  sorted.erase (remove_if (sorted.begin (), sorted.end (), [median, limit] (double sample)
+  { return fabs (sample - median) > limit; }), sorted.end ());
+  return before - sorted.size ();
+}
+
+/**
+ * fills stats from the sorted samples.
+ * @param sorted the sorted samples, must not be empty
+ * @param confidence the confidence level of the interval around the mean
+ * @param stats receives the statistics
+ */
+static void summarize (const vector<double> &sorted, double confidence, BenchStats *stats)
+{
+  double sum = 0;
+  for (double sample : sorted)
+    {
+      sum += sample;
+    }
+  double mean = sum / sorted.size ();
+  double squares = 0;
+  for (double sample : sorted)
+    {
+      squares += (sample - mean) * (sample - mean);
+    }
+  double stddev = sorted.size () > 1 ? sqrt (squares / (sorted.size () - 1)) : 0;
+  double margin = z_score (confidence) * stddev / sqrt ((double) sorted.size ());
+  stats->samples = sorted.size ();
+  stats->min = sorted.front ();
+  stats->median = quantile (sorted, 0.5);
+  stats->p90 = quantile (sorted, P90);
+  stats->p99 = quantile (sorted, P99);
+  stats->max = sorted.back ();
+  stats->mean = mean;
+  stats->stddev = stddev;
+  stats->ci_low = mean - margin;
+  stats->ci_high = mean + margin;
+}
+
+int osm_harness_run (osm_measure measure, unsigned int iterations, const HarnessConfig &config,
+                     BenchStats *stats)
+{
+  if (measure == nullptr || stats == nullptr || iterations == 0 || config.trials == 0)
+    {
+      return FAILURE;
+    }
+  bool pinned = config.cpu != NO_PIN;
+  // CPU_SET has no bounds check of its own
+  if (pinned && (config.cpu < 0 || config.cpu >= CPU_SETSIZE))
+    {
+      return FAILURE;
+    }
+  cpu_set_t old_mask;
+  if (pinned)
+    {
+      cpu_set_t mask;
+      CPU_ZERO (&mask);
+      CPU_SET (config.cpu, &mask);
+      if (sched_getaffinity (0, sizeof (old_mask), &old_mask) < SUCCESS
+          || sched_setaffinity (0, sizeof (mask), &mask) < SUCCESS)
+        {
+          return FAILURE;
+        }
+    }
+  int ret_val = SUCCESS;
+  vector<double> samples;
+  samples.reserve (config.trials);
+  for (unsigned int round = 0; round < config.warmup_rounds && ret_val == SUCCESS; round++)
+    {
+      if (measure (iterations) < 0)
+        {
+          ret_val = FAILURE;
+        }
+    }
+  for (unsigned int trial = 0; trial < config.trials && ret_val == SUCCESS; trial++)
+    {
+      double sample = measure (iterations);
+      if (sample < 0)
+        {
+          ret_val = FAILURE;
+        }
+      samples.push_back (sample);
+    }
+  if (pinned)
+    {
+      sched_setaffinity (0, sizeof (old_mask), &old_mask);
+    }
+  if (ret_val == FAILURE)
+    {
+      return FAILURE;
+    }
+  sort (samples.begin (), samples.end ());
+  stats->rejected = config.reject_outliers ? reject_outliers (samples) : 0;
+  summarize (samples, config.confidence, stats);
+  return SUCCESS;
+}
+
+int osm_operation_stats (unsigned int iterations, const HarnessConfig &config, BenchStats *stats)
+{
+  return osm_harness_run (&osm_operation_time, iterations, config, stats);
+}
+
+int osm_function_stats (unsigned int iterations, const HarnessConfig &config, BenchStats *stats)
+{
+  return osm_harness_run (&osm_function_time, iterations, config, stats);
+}
+
+int osm_syscall_stats (unsigned int iterations, const HarnessConfig &config, BenchStats *stats)
+{
+  return osm_harness_run (&osm_syscall_time, iterations, config, stats);
+}
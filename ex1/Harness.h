@@ -0,0 +1,94 @@
+#ifndef _HARNESS_H_
+#define _HARNESS_H_
+
+/**
+ * a measurement function with the signature of the osm_*_time functions.
+ * returns time in nano-seconds upon success and -1 upon failure.
+ */
+typedef double (*osm_measure) (unsigned int iterations);
+
+/**
+ * the configuration of a harness run.
+ */
+struct HarnessConfig {
+
+  /**
+   * number of untimed trials to run before measuring, lets caches, branch predictors
+   * and the cpu frequency settle.
+   */
+  unsigned int warmup_rounds;
+
+  /**
+   * number of timed trials, each trial is one call to the measurement function.
+   */
+  unsigned int trials;
+
+  /**
+   * the cpu to pin the measuring thread to, or -1 to leave the affinity unchanged.
+   */
+  int cpu;
+
+  /**
+   * if true, trials further than OUTLIER_MADS median absolute deviations from the
+   * median are dropped before the statistics are computed.
+   */
+  bool reject_outliers;
+
+  /**
+   * the confidence level of the interval around the mean: 0.90, 0.95 or 0.99.
+   */
+  double confidence;
+};
+
+/**
+ * the statistics of a harness run, all times are in nano-seconds per operation.
+ */
+struct BenchStats {
+  unsigned int samples;
+  unsigned int rejected;
+  double min;
+  double median;
+  double p90;
+  double p99;
+  double max;
+  double mean;
+  double stddev;
+  double ci_low;
+  double ci_high;
+};
+
+/**
+ * returns a configuration with 10 warmup rounds, 100 trials, no pinning, no outlier
+ * rejection and a 95% confidence interval.
+ */
+HarnessConfig default_harness_config ();
+
+/**
+ * runs measure repeatedly according to config and summarizes the trials.
+ * every trial times iterations operations, so small iterations expose the tail of
+ * single operations while large iterations average them.
+ * @param measure the measurement function
+ * @param iterations number of operations in every trial
+ * @param config the harness configuration
+ * @param stats receives the statistics
+ * @return 0 upon success and -1 upon failure, or if config.cpu is neither -1 nor a valid cpu
+ */
+int osm_harness_run (osm_measure measure, unsigned int iterations, const HarnessConfig &config,
+                     BenchStats *stats);
+
+/* Statistics of osm_operation_time trials.
+   returns 0 upon success, and -1 upon failure.
+   */
+int osm_operation_stats (unsigned int iterations, const HarnessConfig &config, BenchStats *stats);
+
+/* Statistics of osm_function_time trials.
+   returns 0 upon success, and -1 upon failure.
+   */
+int osm_function_stats (unsigned int iterations, const HarnessConfig &config, BenchStats *stats);
+
+/* Statistics of osm_syscall_time trials.
+   returns 0 upon success, and -1 upon failure.
+   */
+int osm_syscall_stats (unsigned int iterations, const HarnessConfig &config, BenchStats *stats);
+
+#endif //_HARNESS_H_
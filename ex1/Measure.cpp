@@ -0,0 +1,154 @@
+#include "Measure.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#define INVARIANT_TSC_LEAF 0x80000007
+#define INVARIANT_TSC_BIT (1u << 8)
+#define CALIBRATION_NS 20000000ull
+#define CALIBRATION_ROUNDS 1000000
+#define CALIBRATION_RUNS 5
+#define TIMER_SAMPLES 1000
+#define NS_IN_SEC 1000000000ull
+
+bool clock_uses_tsc = false;
+
+/**
+ * nano-seconds per clock tick, 1 when the clock is CLOCK_MONOTONIC_RAW.
+ */
+static double ns_per_tick = 1;
+
+/**
+ * the cost of two back to back clock reads, in ticks.
+ */
+static double timer_overhead = 0;
+
+/**
+ * the cost of one empty loop round, in ticks.
+ */
+static double empty_round = 0;
+
+static bool calibrated = false;
+
+/**
+ * reads CLOCK_MONOTONIC_RAW.
+ * @return the current time in nano-seconds
+ */
+static uint64_t raw_ns ()
+{
+  struct timespec now{};
+  clock_gettime (CLOCK_MONOTONIC_RAW, &now);
+  return (uint64_t) now.tv_sec * NS_IN_SEC + now.tv_nsec;
+}
+
+/**
+ * checks if the cpu has an invariant TSC, which ticks at a constant rate
+ * regardless of frequency scaling and sleep states.
+ * @return true if the TSC can be used as a clock
+ */
+static bool has_invariant_tsc ()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+  if (__get_cpuid_max (INVARIANT_TSC_LEAF & 0x80000000, nullptr) < INVARIANT_TSC_LEAF)
+    {
+      return false;
+    }
+  __get_cpuid (INVARIANT_TSC_LEAF, &eax, &ebx, &ecx, &edx);
+  return (edx & INVARIANT_TSC_BIT) != 0;
+#else
+  return false;
+#endif
+}
+
+/**
+ * measures the TSC rate against CLOCK_MONOTONIC_RAW.
+ */
+static void calibrate_tsc ()
+{
+  uint64_t ns_start = raw_ns ();
+  uint64_t ticks_start = read_clock ();
+  uint64_t ns_end = ns_start;
+  while (ns_end - ns_start < CALIBRATION_NS)
+    {
+      ns_end = raw_ns ();
+    }
+  uint64_t ticks_end = read_clock ();
+  ns_per_tick = (double) (ns_end - ns_start) / (double) (ticks_end - ticks_start);
+}
+
+/**
+ * measures the minimal cost of two back to back clock reads.
+ */
+static void calibrate_timer ()
+{
+  uint64_t best = UINT64_MAX;
+  for (int sample = 0; sample < TIMER_SAMPLES; sample++)
+    {
+      uint64_t start = read_clock ();
+      uint64_t end = read_clock ();
+      if (end - start < best)
+        {
+          best = end - start;
+        }
+    }
+  timer_overhead = (double) best;
+}
+
+/**
+ * measures the minimal cost of an empty loop round.
+ */
+static void calibrate_loop ()
+{
+  uint64_t best = UINT64_MAX;
+  for (int run = 0; run < CALIBRATION_RUNS; run++)
+    {
+      uint64_t ticks;
+      TIME_LOOP (CALIBRATION_ROUNDS, (void) 0, ticks);
+      if (ticks < best)
+        {
+          best = ticks;
+        }
+    }
+  empty_round = ((double) best - timer_overhead) / CALIBRATION_ROUNDS;
+  if (empty_round < 0)
+    {
+      empty_round = 0;
+    }
+}
+
+void init_clock ()
+{
+  if (calibrated)
+    {
+      return;
+    }
+  clock_uses_tsc = has_invariant_tsc ();
+  if (clock_uses_tsc)
+    {
+      calibrate_tsc ();
+    }
+  calibrate_timer ();
+  calibrate_loop ();
+  calibrated = true;
+}
+
+unsigned int loop_rounds (unsigned int iterations)
+{
+  return iterations / UNROLL + (iterations % UNROLL != 0);
+}
+
+double ticks_to_ns (double ticks)
+{
+  return ticks * ns_per_tick;
+}
+
+double ticks_per_op_ns (uint64_t ticks, unsigned int rounds)
+{
+  double net = (double) ticks - timer_overhead - empty_round * rounds;
+  if (net < 0)
+    {
+      net = 0;
+    }
+  return ticks_to_ns (net) / ((double) rounds * UNROLL);
+}
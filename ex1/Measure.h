@@ -0,0 +1,98 @@
+#ifndef _MEASURE_H_
+#define _MEASURE_H_
+
+#include <cstdint>
+#include <ctime>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * number of operations executed in every round of a measured loop.
+ */
+#define UNROLL 5
+
+/**
+ * a compiler barrier, keeps the compiler from merging or moving code across rounds.
+ */
+#define COMPILER_BARRIER() asm volatile("" : : : "memory")
+
+/**
+ * true when the invariant TSC is used as the clock, false for CLOCK_MONOTONIC_RAW.
+ */
+extern bool clock_uses_tsc;
+
+/**
+ * reads the clock of the measurement engine.
+ * @return the current time in clock ticks (TSC cycles or nano-seconds)
+ */
+inline uint64_t read_clock ()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  if (clock_uses_tsc)
+    {
+      unsigned int aux;
+      uint64_t ticks = __rdtscp (&aux);
+      _mm_lfence ();
+      return ticks;
+    }
+#endif
+  struct timespec now{};
+  clock_gettime (CLOCK_MONOTONIC_RAW, &now);
+  return (uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/**
+ * times one large loop of rounds, each executing body UNROLL times.
+ * a macro and not a function so the body is inlined at every optimization level.
+ * @param rounds number of loop rounds
+ * @param body the statement to measure, executed UNROLL times per round
+ * @param ticks a uint64_t that receives the elapsed clock ticks
+ */
+#define TIME_LOOP(rounds, body, ticks)                     \
+  do                                                       \
+    {                                                      \
+      uint64_t _loop_start = read_clock ();                \
+      for (unsigned int _round = 0; _round < (rounds); _round++) \
+        {                                                  \
+          body;                                            \
+          body;                                            \
+          body;                                            \
+          body;                                            \
+          body;                                            \
+          COMPILER_BARRIER ();                             \
+        }                                                  \
+      (ticks) = read_clock () - _loop_start;               \
+    }                                                      \
+  while (0)
+
+/**
+ * calibrates the clock, the timer overhead and the empty loop overhead.
+ * called once, later calls return immediately.
+ */
+void init_clock ();
+
+/**
+ * returns the number of loop rounds needed for the given number of iterations.
+ * @param iterations number of operations requested by the user
+ * @return number of rounds, each doing UNROLL operations
+ */
+unsigned int loop_rounds (unsigned int iterations);
+
+/**
+ * converts a measured loop into the time of a single operation, after subtracting
+ * the calibrated empty loop and timer overhead.
+ * @param ticks the clock ticks measured by TIME_LOOP
+ * @param rounds number of rounds the loop ran
+ * @return time of one operation in nano-seconds
+ */
+double ticks_per_op_ns (uint64_t ticks, unsigned int rounds);
+
+/**
+ * converts clock ticks into nano-seconds.
+ * @param ticks clock ticks
+ * @return nano-seconds
+ */
+double ticks_to_ns (double ticks);
+
+#endif //_MEASURE_H_
@@ -0,0 +1,483 @@
+#include "MicroBench.h"
+#include "Measure.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#define SUCCESS 0
+#define FAILURE (-1)
+#define CACHE_LINE 64
+#define READ_END 0
+#define WRITE_END 1
+#define DEFAULT_L1_SIZE (32ul * 1024)
+#define DEFAULT_L2_SIZE (1024ul * 1024)
+#define DEFAULT_L3_SIZE (32ul * 1024 * 1024)
+#define DRAM_L3_FACTOR 8
+#define MIN_DRAM_SIZE (256ul * 1024 * 1024)
+#define BANDWIDTH_L3_FACTOR 4
+#define MIN_BANDWIDTH_SIZE (64ul * 1024 * 1024)
+#define MAJOR_FAULT_DIR "/var/tmp/osm_major_XXXXXX"
+#define PING 1
+#define PONG 0
+
+using namespace std;
+
+//------------------------------helpers--------------------------------------
+
+/**
+ * pins the calling thread to a cpu.
+ * @param cpu the cpu to pin to
+ * @return 0 upon success and -1 upon failure
+ */
+static int pin_to_cpu (int cpu)
+{
+  cpu_set_t mask;
+  CPU_ZERO (&mask);
+  CPU_SET (cpu, &mask);
+  return sched_setaffinity (0, sizeof (mask), &mask);
+}
+
+/**
+ * the two pipes of a ping-pong.
+ */
+struct PingPong {
+  int to_peer[2];
+  int to_self[2];
+  unsigned int iterations;
+  int cpu;
+};
+
+/**
+ * closes one end of a pipe and marks it closed, so it is not closed again after another
+ * thread may have reused its number.
+ * @param fd the end, skipped if it is negative
+ */
+static void close_end (int *fd)
+{
+  if (*fd >= 0)
+    {
+      close (*fd);
+      *fd = -1;
+    }
+}
+
+/**
+ * closes both pipes of a ping-pong, skipping the ends closed already.
+ * @param pp the ping-pong
+ */
+static void close_pipes (PingPong *pp)
+{
+  close_end (&pp->to_peer[READ_END]);
+  close_end (&pp->to_peer[WRITE_END]);
+  close_end (&pp->to_self[READ_END]);
+  close_end (&pp->to_self[WRITE_END]);
+}
+
+/**
+ * the peer side of a ping-pong: echoes every byte it receives.
+ * @param arg the PingPong
+ * @return nullptr
+ */
+static void *echo (void *arg)
+{
+  auto *pp = (PingPong *) arg;
+  pin_to_cpu (pp->cpu);
+  char byte;
+  for (unsigned int i = 0; i < pp->iterations; i++)
+    {
+      if (read (pp->to_peer[READ_END], &byte, 1) != 1 || write (pp->to_self[WRITE_END], &byte, 1) != 1)
+        {
+          break;
+        }
+    }
+  return nullptr;
+}
+
+/**
+ * the measuring side of a ping-pong.
+ * @param pp the ping-pong
+ * @return the time of half a round trip in nano-seconds, or -1 upon failure
+ */
+static double ping (PingPong *pp)
+{
+  char byte = 0;
+  uint64_t start = read_clock ();
+  for (unsigned int i = 0; i < pp->iterations; i++)
+    {
+      if (write (pp->to_peer[WRITE_END], &byte, 1) != 1 || read (pp->to_self[READ_END], &byte, 1) != 1)
+        {
+          return FAILURE;
+        }
+    }
+  uint64_t end = read_clock ();
+  return ticks_to_ns ((double) (end - start)) / (2.0 * pp->iterations);
+}
+
+/**
+ * prepares a ping-pong on the cpu the caller runs on, and pins the caller to it.
+ * @param pp the ping-pong to fill
+ * @param iterations number of round trips
+ * @param old_mask receives the affinity of the caller
+ * @return 0 upon success and -1 upon failure
+ */
+static int open_ping_pong (PingPong *pp, unsigned int iterations, cpu_set_t *old_mask)
+{
+  pp->iterations = iterations;
+  pp->cpu = sched_getcpu ();
+  if (pp->cpu < SUCCESS || sched_getaffinity (0, sizeof (*old_mask), old_mask) < SUCCESS)
+    {
+      return FAILURE;
+    }
+  if (pipe (pp->to_peer) < SUCCESS)
+    {
+      return FAILURE;
+    }
+  if (pipe (pp->to_self) < SUCCESS)
+    {
+      close (pp->to_peer[READ_END]);
+      close (pp->to_peer[WRITE_END]);
+      return FAILURE;
+    }
+  pin_to_cpu (pp->cpu);
+  return SUCCESS;
+}
+
+/**
+ * returns the size of a cache level, or a default if the system does not report it.
+ * @param name the sysconf name of the cache size
+ * @param fallback the default size
+ * @return the cache size in bytes
+ */
+static unsigned long cache_size (int name, unsigned long fallback)
+{
+  long size = sysconf (name);
+  return size > 0 ? (unsigned long) size : fallback;
+}
+
+/**
+ * returns the size of the last level cache.
+ */
+static unsigned long l3_size ()
+{
+  return cache_size (_SC_LEVEL3_CACHE_SIZE, DEFAULT_L3_SIZE);
+}
+
+static long futex (int *addr, int op, int val)
+{
+  return syscall (SYS_futex, addr, op, val, nullptr, nullptr, 0);
+}
+
+/**
+ * waits until the futex word holds the wanted value.
+ * @param word the futex word
+ * @param wanted the value to wait for
+ */
+static void futex_wait_for (int *word, int wanted)
+{
+  int cur;
+  while ((cur = __atomic_load_n (word, __ATOMIC_ACQUIRE)) != wanted)
+    {
+      futex (word, FUTEX_WAIT_PRIVATE, cur);
+    }
+}
+
+/**
+ * stores a value in the futex word and wakes its waiter.
+ * @param word the futex word
+ * @param value the value to store
+ */
+static void futex_post (int *word, int value)
+{
+  __atomic_store_n (word, value, __ATOMIC_RELEASE);
+  futex (word, FUTEX_WAKE_PRIVATE, 1);
+}
+
+/**
+ * the state shared by the two sides of a futex ping-pong.
+ */
+struct FutexPingPong {
+  int word;
+  unsigned int iterations;
+};
+
+/**
+ * the peer side of a futex ping-pong: answers every PING with a PONG.
+ * @param arg the FutexPingPong
+ * @return nullptr
+ */
+static void *futex_echo (void *arg)
+{
+  auto *fp = (FutexPingPong *) arg;
+  for (unsigned int i = 0; i < fp->iterations; i++)
+    {
+      futex_wait_for (&fp->word, PING);
+      futex_post (&fp->word, PONG);
+    }
+  return nullptr;
+}
+
+//------------------------------benchmarks-----------------------------------
+
+double osm_process_switch_time (unsigned int iterations)
+{
+  if (iterations == 0)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  PingPong pp{};
+  cpu_set_t old_mask;
+  if (open_ping_pong (&pp, iterations, &old_mask) < SUCCESS)
+    {
+      return FAILURE;
+    }
+  pid_t pid = fork ();
+  if (pid < SUCCESS)
+    {
+      close_pipes (&pp);
+      sched_setaffinity (0, sizeof (old_mask), &old_mask);
+      return FAILURE;
+    }
+  if (pid == 0)
+    {
+      close (pp.to_peer[WRITE_END]);
+      close (pp.to_self[READ_END]);
+      echo (&pp);
+      _exit (EXIT_SUCCESS);
+    }
+  // without the child's ends, either side sees EOF if the other stops early
+  close (pp.to_peer[READ_END]);
+  close (pp.to_self[WRITE_END]);
+  double result = ping (&pp);
+  close (pp.to_peer[WRITE_END]);
+  close (pp.to_self[READ_END]);
+  waitpid (pid, nullptr, 0);
+  sched_setaffinity (0, sizeof (old_mask), &old_mask);
+  return result;
+}
+
+double osm_thread_switch_time (unsigned int iterations)
+{
+  if (iterations == 0)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  PingPong pp{};
+  cpu_set_t old_mask;
+  if (open_ping_pong (&pp, iterations, &old_mask) < SUCCESS)
+    {
+      return FAILURE;
+    }
+  pthread_t peer;
+  if (pthread_create (&peer, nullptr, echo, &pp) != SUCCESS)
+    {
+      close_pipes (&pp);
+      sched_setaffinity (0, sizeof (old_mask), &old_mask);
+      return FAILURE;
+    }
+  double result = ping (&pp);
+  if (result < 0)
+    {
+      close_end (&pp.to_peer[WRITE_END]);
+    }
+  pthread_join (peer, nullptr);
+  close_pipes (&pp);
+  sched_setaffinity (0, sizeof (old_mask), &old_mask);
+  return result;
+}
+
+double osm_minor_fault_time (unsigned int iterations)
+{
+  if (iterations == 0)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  size_t page = sysconf (_SC_PAGESIZE);
+  size_t length = page * iterations;
+  void *mem = mmap (nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED)
+    {
+      return FAILURE;
+    }
+  volatile char *bytes = (volatile char *) mem;
+  uint64_t start = read_clock ();
+  for (size_t offset = 0; offset < length; offset += page)
+    {
+      bytes[offset] = 1;
+    }
+  uint64_t end = read_clock ();
+  munmap (mem, length);
+  return ticks_to_ns ((double) (end - start)) / iterations;
+}
+
+double osm_major_fault_time (unsigned int iterations)
+{
+  if (iterations == 0)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  size_t page = sysconf (_SC_PAGESIZE);
+  size_t length = page * iterations;
+  char path[] = MAJOR_FAULT_DIR;
+  int fd = mkstemp (path);
+  if (fd < SUCCESS)
+    {
+      return FAILURE;
+    }
+  unlink (path);
+  vector<char> data (page, 1);
+  for (unsigned int i = 0; i < iterations; i++)
+    {
+      if (write (fd, data.data (), page) != (ssize_t) page)
+        {
+          close (fd);
+          return FAILURE;
+        }
+    }
+  fsync (fd);
+  posix_fadvise (fd, 0, length, POSIX_FADV_DONTNEED);
+  void *mem = mmap (nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mem == MAP_FAILED)
+    {
+      close (fd);
+      return FAILURE;
+    }
+  madvise (mem, length, MADV_RANDOM);
+  volatile const char *bytes = (volatile const char *) mem;
+  size_t sink = 0;
+  uint64_t start = read_clock ();
+  for (size_t offset = 0; offset < length; offset += page)
+    {
+      sink += bytes[offset];
+    }
+  uint64_t end = read_clock ();
+  munmap (mem, length);
+  close (fd);
+  return sink != iterations ? FAILURE : ticks_to_ns ((double) (end - start)) / iterations;
+}
+
+double osm_memory_latency (unsigned long size_bytes, unsigned int iterations)
+{
+  size_t lines = size_bytes / CACHE_LINE;
+  if (iterations == 0 || lines < 2)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  void *mem = mmap (nullptr, lines * CACHE_LINE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED)
+    {
+      return FAILURE;
+    }
+  char *base = (char *) mem;
+  // Sattolo's shuffle: a random permutation with a single cycle through every line
+  vector<size_t> order (lines);
+  for (size_t line = 0; line < lines; line++)
+    {
+      order[line] = line;
+    }
+  mt19937_64 generator (lines);
+  for (size_t line = lines - 1; line > 0; line--)
+    {
+      uniform_int_distribution<size_t> pick (0, line - 1);
+      swap (order[line], order[pick (generator)]);
+    }
+  for (size_t line = 0; line < lines; line++)
+    {
+      *(char **) (base + order[line] * CACHE_LINE) = base + order[(line + 1) % lines] * CACHE_LINE;
+    }
+  char *p = base;
+  for (size_t line = 0; line < lines; line++)
+    {
+      p = *(char **) p;
+    }
+  unsigned int rounds = loop_rounds (iterations);
+  uint64_t ticks;
+  TIME_LOOP (rounds, p = *(char **) p, ticks);
+  munmap (mem, lines * CACHE_LINE);
+  return p == nullptr ? FAILURE : ticks_per_op_ns (ticks, rounds);
+}
+
+double osm_l1_latency (unsigned int iterations)
+{
+  return osm_memory_latency (cache_size (_SC_LEVEL1_DCACHE_SIZE, DEFAULT_L1_SIZE) / 2, iterations);
+}
+
+double osm_l2_latency (unsigned int iterations)
+{
+  return osm_memory_latency (cache_size (_SC_LEVEL2_CACHE_SIZE, DEFAULT_L2_SIZE) / 2, iterations);
+}
+
+double osm_l3_latency (unsigned int iterations)
+{
+  return osm_memory_latency (l3_size () / 2, iterations);
+}
+
+double osm_dram_latency (unsigned int iterations)
+{
+  return osm_memory_latency (max (DRAM_L3_FACTOR * l3_size (), MIN_DRAM_SIZE), iterations);
+}
+
+double osm_memory_bandwidth (unsigned int iterations)
+{
+  if (iterations == 0)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  size_t length = max (BANDWIDTH_L3_FACTOR * l3_size (), MIN_BANDWIDTH_SIZE);
+  void *mem = mmap (nullptr, 2 * length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED)
+    {
+      return FAILURE;
+    }
+  char *src = (char *) mem;
+  char *dst = src + length;
+  memset (mem, 1, 2 * length);
+  uint64_t start = read_clock ();
+  for (unsigned int i = 0; i < iterations; i++)
+    {
+      memcpy (dst, src, length);
+      COMPILER_BARRIER ();
+    }
+  uint64_t end = read_clock ();
+  munmap (mem, 2 * length);
+  return (double) length * iterations / ticks_to_ns ((double) (end - start));
+}
+
+double osm_futex_wake_time (unsigned int iterations)
+{
+  if (iterations == 0)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  FutexPingPong fp{PONG, iterations};
+  pthread_t peer;
+  if (pthread_create (&peer, nullptr, futex_echo, &fp) != SUCCESS)
+    {
+      return FAILURE;
+    }
+  uint64_t start = read_clock ();
+  for (unsigned int i = 0; i < iterations; i++)
+    {
+      futex_post (&fp.word, PING);
+      futex_wait_for (&fp.word, PONG);
+    }
+  uint64_t end = read_clock ();
+  pthread_join (peer, nullptr);
+  return ticks_to_ns ((double) (end - start)) / (2.0 * iterations);
+}
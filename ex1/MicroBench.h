@@ -0,0 +1,72 @@
+#ifndef _MICRO_BENCH_H_
+#define _MICRO_BENCH_H_
+
+/*
+ * The micro-benchmark suite. Every function has the signature of the osm_*_time
+ * functions, so it can be passed to osm_harness_run, and returns -1 upon failure.
+ * Programs using it must be linked with -pthread.
+ */
+
+/* Time measurement function for a context switch between two processes, pinned to
+   the same cpu and playing ping-pong over a pair of pipes.
+   returns the time of one switch (half a round trip) in nano-seconds upon success,
+   and -1 upon failure.
+   */
+double osm_process_switch_time (unsigned int iterations);
+
+/* Time measurement function for a context switch between two threads of the same
+   process, pinned to the same cpu and playing ping-pong over a pair of pipes.
+   returns the time of one switch (half a round trip) in nano-seconds upon success,
+   and -1 upon failure.
+   */
+double osm_thread_switch_time (unsigned int iterations);
+
+/* Time measurement function for a minor page fault: the first write to a page of
+   fresh anonymous memory. iterations is the number of pages touched.
+   returns the time of one fault in nano-seconds upon success,
+   and -1 upon failure.
+   */
+double osm_minor_fault_time (unsigned int iterations);
+
+/* Time measurement function for a major page fault: the first read of a page of a
+   file mapping whose data was dropped from the page cache. iterations is the number
+   of pages touched.
+   returns the time of one fault in nano-seconds upon success,
+   and -1 upon failure.
+   */
+double osm_major_fault_time (unsigned int iterations);
+
+/* Time measurement function for a dependent load from a buffer of size_bytes bytes,
+   using a random pointer chasing chain of cache lines.
+   returns the time of one load in nano-seconds upon success,
+   and -1 upon failure.
+   */
+double osm_memory_latency (unsigned long size_bytes, unsigned int iterations);
+
+/* osm_memory_latency with a buffer that fits in half of the L1 data cache. */
+double osm_l1_latency (unsigned int iterations);
+
+/* osm_memory_latency with a buffer that fits in half of the L2 cache. */
+double osm_l2_latency (unsigned int iterations);
+
+/* osm_memory_latency with a buffer that fits in half of the L3 cache. */
+double osm_l3_latency (unsigned int iterations);
+
+/* osm_memory_latency with a buffer much larger than the L3 cache. */
+double osm_dram_latency (unsigned int iterations);
+
+/* Bandwidth measurement function for copying a buffer much larger than the L3 cache.
+   iterations is the number of times the buffer is copied.
+   returns the bandwidth in bytes per nano-second (GB/s) upon success,
+   and -1 upon failure.
+   */
+double osm_memory_bandwidth (unsigned int iterations);
+
+/* Time measurement function for waking a thread that waits on a futex, measured as
+   half of a futex ping-pong round trip between two threads.
+   returns the time of one wake up in nano-seconds upon success,
+   and -1 upon failure.
+   */
+double osm_futex_wake_time (unsigned int iterations);
+
+#endif //_MICRO_BENCH_H_
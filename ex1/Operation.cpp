@@ -0,0 +1,121 @@
+#include "Operation.h"
+#include "Measure.h"
+
+#define FAILURE (-1)
+#define INDEPENDENT_CHAINS 8
+#define START_VALUE 0x123456789abcdefull
+
+/**
+ * applies a step to every one of the INDEPENDENT_CHAINS accumulators.
+ */
+#define EACH_CHAIN(step) \
+  step (a0); step (a1); step (a2); step (a3); step (a4); step (a5); step (a6); step (a7)
+
+#define ADD_STEP(v) v += one; OPAQUE (v)
+#define MUL_STEP(v) v *= one; OPAQUE (v)
+#define DIV_STEP(v) v /= one; OPAQUE (v)
+
+/**
+ * measures the kind in OP_LATENCY mode.
+ * @param rounds number of loop rounds
+ * @param kind the instruction kind
+ * @param ticks receives the elapsed clock ticks
+ * @return the number of instructions in every round body
+ */
+static int latency_loop (unsigned int rounds, OpKind kind, uint64_t *ticks)
+{
+  uint64_t one = 1;
+  uint64_t x = START_VALUE;
+  volatile uint64_t slot = 0;
+  char *cell = (char *) &cell;
+  char *p = cell;
+  OPAQUE (one);
+  switch (kind)
+    {
+      case OP_ADD:
+        TIME_LOOP (rounds, ADD_STEP (x), *ticks);
+      break;
+      case OP_MUL:
+        TIME_LOOP (rounds, MUL_STEP (x), *ticks);
+      break;
+      case OP_DIV:
+        TIME_LOOP (rounds, DIV_STEP (x), *ticks);
+      break;
+      case OP_LOAD:
+        TIME_LOOP (rounds, p = *(char *volatile *) p, *ticks);
+      break;
+      case OP_STORE:
+        TIME_LOOP (rounds, slot = x; x = slot, *ticks);
+      break;
+      default:
+        return FAILURE;
+    }
+  OPAQUE (x);
+  OPAQUE (p);
+  return 1;
+}
+
+/**
+ * measures the kind in OP_THROUGHPUT mode.
+ * @param rounds number of loop rounds
+ * @param kind the instruction kind
+ * @param ticks receives the elapsed clock ticks
+ * @return the number of instructions in every round body
+ */
+static int throughput_loop (unsigned int rounds, OpKind kind, uint64_t *ticks)
+{
+  uint64_t one = 1;
+  uint64_t a0 = START_VALUE, a1 = START_VALUE, a2 = START_VALUE, a3 = START_VALUE;
+  uint64_t a4 = START_VALUE, a5 = START_VALUE, a6 = START_VALUE, a7 = START_VALUE;
+  volatile uint64_t slots[INDEPENDENT_CHAINS] = {};
+  OPAQUE (one);
+  switch (kind)
+    {
+      case OP_ADD:
+        TIME_LOOP (rounds, EACH_CHAIN (ADD_STEP), *ticks);
+      break;
+      case OP_MUL:
+        TIME_LOOP (rounds, EACH_CHAIN (MUL_STEP), *ticks);
+      break;
+      case OP_DIV:
+        TIME_LOOP (rounds, EACH_CHAIN (DIV_STEP), *ticks);
+      break;
+      case OP_LOAD:
+        TIME_LOOP (rounds, a0 = slots[0]; a1 = slots[1]; a2 = slots[2]; a3 = slots[3];
+                   a4 = slots[4]; a5 = slots[5]; a6 = slots[6]; a7 = slots[7], *ticks);
+      break;
+      case OP_STORE:
+        TIME_LOOP (rounds, slots[0] = a0; slots[1] = a1; slots[2] = a2; slots[3] = a3;
+                   slots[4] = a4; slots[5] = a5; slots[6] = a6; slots[7] = a7, *ticks);
+      break;
+      default:
+        return FAILURE;
+    }
+  EACH_CHAIN (OPAQUE);
+  return INDEPENDENT_CHAINS;
+}
+
+double osm_instruction_time (unsigned int iterations, OpKind kind, OpMode mode)
+{
+  if (iterations == 0)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  unsigned int rounds = loop_rounds (iterations);
+  uint64_t ticks = 0;
+  int per_body = FAILURE;
+  if (mode == OP_LATENCY)
+    {
+      per_body = latency_loop (rounds, kind, &ticks);
+    }
+  else if (mode == OP_THROUGHPUT)
+    {
+      per_body = throughput_loop (rounds, kind, &ticks);
+    }
+  if (per_body == FAILURE)
+    {
+      return FAILURE;
+    }
+  return ticks_per_op_ns (ticks, rounds) / per_body;
+}
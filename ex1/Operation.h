@@ -0,0 +1,41 @@
+#ifndef _OPERATION_H_
+#define _OPERATION_H_
+
+/**
+ * the instruction measured by osm_instruction_time.
+ */
+enum OpKind {
+  OP_ADD,
+  OP_MUL,
+  OP_DIV,
+  OP_LOAD,
+  OP_STORE
+};
+
+/**
+ * how the instructions of a measurement depend on each other.
+ * OP_LATENCY chains every instruction on the result of the previous one, so the
+ * result is the time until a result is ready. OP_THROUGHPUT runs INDEPENDENT_CHAINS
+ * chains side by side, so the result is the issue cost of one instruction.
+ * a store has no result, its latency is measured as a store followed by a load
+ * from the same address (store to load forwarding).
+ */
+enum OpMode {
+  OP_LATENCY,
+  OP_THROUGHPUT
+};
+
+/**
+ * keeps the compiler from folding or removing operations on a variable: the value
+ * must be in a register and may have been changed by the (empty) assembly.
+ */
+#define OPAQUE(x) asm volatile("" : "+r" (x))
+
+/* Time measurement function for a single instruction of the given kind and mode.
+   the measured instructions survive any optimization level.
+   returns time in nano-seconds upon success,
+   and -1 upon failure.
+   */
+double osm_instruction_time (unsigned int iterations, OpKind kind, OpMode mode);
+
+#endif //_OPERATION_H_
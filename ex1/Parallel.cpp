@@ -0,0 +1,488 @@
+#include "Parallel.h"
+#include "Measure.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <pthread.h>
+#include <sched.h>
+
+#define SUCCESS 0
+#define FAILURE (-1)
+#define CACHE_LINE 64
+#define MAX_NODES 64
+#define NODE_CPULIST "/sys/devices/system/node/node%d/cpulist"
+#define PATH_LEN 64
+#define PING 1
+#define PONG 0
+#define GATE_CLOSED 0
+#define GATE_OPEN 1
+#define GATE_CANCELLED 2
+
+using namespace std;
+
+/**
+ * a measurement run by one of the pinned threads.
+ * @param index the index of the thread, from 0 to num_threads - 1
+ * @param arg the argument given to run_pinned
+ * @return the result of the thread, or -1 upon failure
+ */
+typedef double (*thread_measure) (unsigned int index, void *arg);
+
+/**
+ * holds the pinned threads until all of them are created, or sends them home if one
+ * cannot be created.
+ */
+struct StartGate {
+  pthread_mutex_t mutex;
+  pthread_cond_t opened;
+  int state;
+};
+
+/**
+ * the state of a pinned thread.
+ */
+struct PinnedThread {
+  pthread_t thread;
+  int cpu;
+  unsigned int index;
+  thread_measure measure;
+  void *arg;
+  StartGate *gate;
+  pthread_barrier_t *start;
+  double result;
+};
+
+/**
+ * the argument of osm_parallel_run threads.
+ */
+struct MeasureCall {
+  osm_measure measure;
+  unsigned int iterations;
+};
+
+/**
+ * the argument of the contention probes: one cache line aligned buffer.
+ */
+struct CounterBuffer {
+  char *buffer;
+  unsigned int iterations;
+};
+
+//------------------------------helpers--------------------------------------
+
+/**
+ * returns the cpus the calling thread may run on.
+ */
+static vector<int> allowed_cpus ()
+{
+  vector<int> cpus;
+  cpu_set_t mask;
+  if (sched_getaffinity (0, sizeof (mask), &mask) < SUCCESS)
+    {
+      return cpus;
+    }
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+      if (CPU_ISSET (cpu, &mask))
+        {
+          cpus.push_back (cpu);
+        }
+    }
+  return cpus;
+}
+
+/**
+ * pins the calling thread to a cpu.
+ * @param cpu the cpu to pin to
+ * @return 0 upon success and -1 upon failure
+ */
+static int pin_to_cpu (int cpu)
+{
+  cpu_set_t mask;
+  CPU_ZERO (&mask);
+  CPU_SET (cpu, &mask);
+  return sched_setaffinity (0, sizeof (mask), &mask);
+}
+
+/**
+ * waits until the gate is opened or cancelled.
+ * @param gate the gate
+ * @return true if it was opened
+ */
+static bool pass_gate (StartGate *gate)
+{
+  pthread_mutex_lock (&gate->mutex);
+  while (gate->state == GATE_CLOSED)
+    {
+      pthread_cond_wait (&gate->opened, &gate->mutex);
+    }
+  bool open = gate->state == GATE_OPEN;
+  pthread_mutex_unlock (&gate->mutex);
+  return open;
+}
+
+/**
+ * opens or cancels the gate.
+ * @param gate the gate
+ * @param state GATE_OPEN or GATE_CANCELLED
+ */
+static void set_gate (StartGate *gate, int state)
+{
+  pthread_mutex_lock (&gate->mutex);
+  gate->state = state;
+  pthread_cond_broadcast (&gate->opened);
+  pthread_mutex_unlock (&gate->mutex);
+}
+
+/**
+ * the body of a pinned thread: pins itself, waits for all the others and measures.
+ * @param arg the PinnedThread
+ * @return nullptr
+ */
+static void *pinned_main (void *arg)
+{
+  auto *self = (PinnedThread *) arg;
+  pin_to_cpu (self->cpu);
+  if (!pass_gate (self->gate))
+    {
+      return nullptr;
+    }
+  pthread_barrier_wait (self->start);
+  self->result = self->measure (self->index, self->arg);
+  return nullptr;
+}
+
+/**
+ * runs measure on threads pinned to the given cpus, released together.
+ * @param cpus the cpu of every thread
+ * @param measure the measurement of every thread
+ * @param arg passed to measure
+ * @param results receives the result of every thread
+ * @return 0 upon success and -1 upon failure
+ */
+static int run_pinned (const vector<int> &cpus, thread_measure measure, void *arg, vector<double> &results)
+{
+  vector<PinnedThread> threads (cpus.size ());
+  pthread_barrier_t start;
+  if (cpus.empty () || pthread_barrier_init (&start, nullptr, cpus.size ()) != SUCCESS)
+    {
+      return FAILURE;
+    }
+  StartGate gate{PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, GATE_CLOSED};
+  size_t created = 0;
+  for (; created < cpus.size (); created++)
+    {
+      threads[created] = PinnedThread{0, cpus[created], (unsigned int) created, measure, arg, &gate, &start,
+                                      FAILURE};
+      if (pthread_create (&threads[created].thread, nullptr, pinned_main, &threads[created]) != SUCCESS)
+        {
+          break;
+        }
+    }
+  // the barrier only counts full sets, so the threads reach it only once all of them exist
+  set_gate (&gate, created < cpus.size () ? GATE_CANCELLED : GATE_OPEN);
+  results.clear ();
+  int ret_val = created < cpus.size () ? FAILURE : SUCCESS;
+  for (size_t index = 0; index < created; index++)
+    {
+      PinnedThread &thread = threads[index];
+      pthread_join (thread.thread, nullptr);
+      results.push_back (thread.result);
+      if (thread.result < 0)
+        {
+          ret_val = FAILURE;
+        }
+    }
+  pthread_barrier_destroy (&start);
+  pthread_cond_destroy (&gate.opened);
+  pthread_mutex_destroy (&gate.mutex);
+  return ret_val;
+}
+
+/**
+ * returns num_threads cpus, assigned round robin over the allowed cpus.
+ */
+static vector<int> round_robin_cpus (unsigned int num_threads)
+{
+  vector<int> allowed = allowed_cpus ();
+  vector<int> cpus;
+  for (unsigned int index = 0; index < num_threads && !allowed.empty (); index++)
+    {
+      cpus.push_back (allowed[index % allowed.size ()]);
+    }
+  return cpus;
+}
+
+/**
+ * returns the mean of the results.
+ */
+static double mean_of (const vector<double> &results)
+{
+  double sum = 0;
+  for (double result : results)
+    {
+      sum += result;
+    }
+  return sum / results.size ();
+}
+
+/**
+ * runs one of the contention probes on num_threads threads.
+ * @param num_threads number of threads
+ * @param iterations number of increments of every thread
+ * @param probe the per thread loop
+ * @return the mean time of an increment in nano-seconds, or -1 upon failure
+ */
+static double run_probe (unsigned int num_threads, unsigned int iterations, thread_measure probe)
+{
+  if (num_threads == 0 || iterations == 0)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  void *buffer = nullptr;
+  if (posix_memalign (&buffer, CACHE_LINE, (size_t) num_threads * CACHE_LINE) != SUCCESS)
+    {
+      return FAILURE;
+    }
+  memset (buffer, 0, (size_t) num_threads * CACHE_LINE);
+  CounterBuffer counters{(char *) buffer, iterations};
+  vector<double> results;
+  int ret_val = run_pinned (round_robin_cpus (num_threads), probe, &counters, results);
+  free (buffer);
+  return ret_val == FAILURE ? FAILURE : mean_of (results);
+}
+
+/**
+ * parses a cpulist such as "0-3,8-11".
+ */
+static vector<int> parse_cpulist (const string &list)
+{
+  vector<int> cpus;
+  size_t pos = 0;
+  while (pos < list.size ())
+    {
+      char *end;
+      long first = strtol (list.c_str () + pos, &end, 10);
+      long last = first;
+      if (*end == '-')
+        {
+          last = strtol (end + 1, &end, 10);
+        }
+      for (long cpu = first; cpu <= last; cpu++)
+        {
+          cpus.push_back ((int) cpu);
+        }
+      pos = end - list.c_str ();
+      if (pos < list.size () && list[pos] != ',')
+        {
+          break;
+        }
+      pos++;
+    }
+  return cpus;
+}
+
+/**
+ * returns the allowed cpus of every NUMA node that has any, a single node holding
+ * every allowed cpu if the system does not describe its nodes.
+ */
+static vector<vector<int>> numa_nodes ()
+{
+  vector<int> allowed = allowed_cpus ();
+  vector<vector<int>> nodes;
+  for (int node = 0; node < MAX_NODES; node++)
+    {
+      char path[PATH_LEN];
+      snprintf (path, sizeof (path), NODE_CPULIST, node);
+      ifstream file (path);
+      string list;
+      if (!getline (file, list))
+        {
+          continue;
+        }
+      vector<int> cpus;
+      for (int cpu : parse_cpulist (list))
+        {
+          if (find (allowed.begin (), allowed.end (), cpu) != allowed.end ())
+            {
+              cpus.push_back (cpu);
+            }
+        }
+      if (!cpus.empty ())
+        {
+          nodes.push_back (cpus);
+        }
+    }
+  if (nodes.empty () && !allowed.empty ())
+    {
+      nodes.push_back (allowed);
+    }
+  return nodes;
+}
+
+//------------------------------thread bodies--------------------------------
+
+/**
+ * calls the osm_*_time function of a MeasureCall.
+ */
+static double call_measure (unsigned int index, void *arg)
+{
+  auto *call = (MeasureCall *) arg;
+  return call->measure (call->iterations);
+}
+
+/**
+ * atomic increments of the first counter of the buffer, shared by all threads.
+ */
+static double shared_atomic_loop (unsigned int index, void *arg)
+{
+  auto *counters = (CounterBuffer *) arg;
+  auto *counter = (uint64_t *) counters->buffer;
+  unsigned int rounds = loop_rounds (counters->iterations);
+  uint64_t ticks;
+  TIME_LOOP (rounds, __atomic_fetch_add (counter, 1, __ATOMIC_SEQ_CST), ticks);
+  return ticks_per_op_ns (ticks, rounds);
+}
+
+/**
+ * atomic increments of a counter in the cache line of the thread.
+ */
+static double padded_atomic_loop (unsigned int index, void *arg)
+{
+  auto *counters = (CounterBuffer *) arg;
+  auto *counter = (uint64_t *) (counters->buffer + (size_t) index * CACHE_LINE);
+  unsigned int rounds = loop_rounds (counters->iterations);
+  uint64_t ticks;
+  TIME_LOOP (rounds, __atomic_fetch_add (counter, 1, __ATOMIC_SEQ_CST), ticks);
+  return ticks_per_op_ns (ticks, rounds);
+}
+
+/**
+ * plain increments of the counter of the thread, next to the counters of the others.
+ */
+static double false_sharing_loop (unsigned int index, void *arg)
+{
+  auto *counters = (CounterBuffer *) arg;
+  auto *counter = (volatile uint64_t *) counters->buffer + index;
+  unsigned int rounds = loop_rounds (counters->iterations);
+  uint64_t ticks;
+  TIME_LOOP (rounds, *counter = *counter + 1, ticks);
+  return ticks_per_op_ns (ticks, rounds);
+}
+
+/**
+ * one side of a cache line ping-pong: thread 0 sends PING and waits for PONG,
+ * thread 1 answers.
+ */
+static double transfer_loop (unsigned int index, void *arg)
+{
+  auto *counters = (CounterBuffer *) arg;
+  auto *flag = (int *) counters->buffer;
+  int wait_for = index == 0 ? PONG : PING;
+  int answer = index == 0 ? PING : PONG;
+  uint64_t start = read_clock ();
+  for (unsigned int i = 0; i < counters->iterations; i++)
+    {
+      if (index == 0)
+        {
+          __atomic_store_n (flag, answer, __ATOMIC_RELEASE);
+        }
+      while (__atomic_load_n (flag, __ATOMIC_ACQUIRE) != wait_for)
+        {
+        }
+      if (index == 1)
+        {
+          __atomic_store_n (flag, answer, __ATOMIC_RELEASE);
+        }
+    }
+  uint64_t end = read_clock ();
+  return ticks_to_ns ((double) (end - start)) / (2.0 * counters->iterations);
+}
+
+//------------------------------api------------------------------------------
+
+int osm_parallel_run (osm_measure measure, unsigned int iterations, unsigned int num_threads,
+                      ParallelResult *result)
+{
+  if (measure == nullptr || result == nullptr || iterations == 0 || num_threads == 0)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  MeasureCall call{measure, iterations};
+  result->cpus = round_robin_cpus (num_threads);
+  if (run_pinned (result->cpus, call_measure, &call, result->per_thread) < SUCCESS)
+    {
+      return FAILURE;
+    }
+  result->mean = mean_of (result->per_thread);
+  result->max = 0;
+  result->aggregate_rate = 0;
+  for (double per_op : result->per_thread)
+    {
+      result->max = max (result->max, per_op);
+      result->aggregate_rate += per_op > 0 ? 1 / per_op : 0;
+    }
+  return SUCCESS;
+}
+
+double osm_shared_atomic_time (unsigned int num_threads, unsigned int iterations)
+{
+  return run_probe (num_threads, iterations, shared_atomic_loop);
+}
+
+double osm_padded_atomic_time (unsigned int num_threads, unsigned int iterations)
+{
+  return run_probe (num_threads, iterations, padded_atomic_loop);
+}
+
+double osm_false_sharing_time (unsigned int num_threads, unsigned int iterations)
+{
+  return run_probe (num_threads, iterations, false_sharing_loop);
+}
+
+double osm_cacheline_transfer_time (int cpu_a, int cpu_b, unsigned int iterations)
+{
+  if (iterations == 0 || cpu_a == cpu_b)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  void *buffer = nullptr;
+  if (posix_memalign (&buffer, CACHE_LINE, CACHE_LINE) != SUCCESS)
+    {
+      return FAILURE;
+    }
+  memset (buffer, 0, CACHE_LINE);
+  CounterBuffer flag{(char *) buffer, iterations};
+  vector<double> results;
+  int ret_val = run_pinned ({cpu_a, cpu_b}, transfer_loop, &flag, results);
+  free (buffer);
+  return ret_val == FAILURE ? FAILURE : results[0];
+}
+
+double osm_local_transfer_time (unsigned int iterations)
+{
+  for (const vector<int> &node : numa_nodes ())
+    {
+      if (node.size () >= 2)
+        {
+          return osm_cacheline_transfer_time (node[0], node[1], iterations);
+        }
+    }
+  return FAILURE;
+}
+
+double osm_remote_transfer_time (unsigned int iterations)
+{
+  vector<vector<int>> nodes = numa_nodes ();
+  if (nodes.size () < 2)
+    {
+      return FAILURE;
+    }
+  return osm_cacheline_transfer_time (nodes[0][0], nodes[1][0], iterations);
+}
@@ -0,0 +1,89 @@
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+#include <vector>
+#include "Harness.h"
+
+/*
+ * Multi-core measurements. Threads are pinned round robin to the cpus the caller is
+ * allowed to run on and released together, so every thread measures while all the
+ * others run. Programs using it must be linked with -pthread.
+ */
+
+/**
+ * the result of a measurement run on several threads at once.
+ */
+struct ParallelResult {
+
+  /**
+   * the cpu every thread was pinned to.
+   */
+  std::vector<int> cpus;
+
+  /**
+   * the result of every thread, in nano-seconds per operation.
+   */
+  std::vector<double> per_thread;
+
+  /**
+   * the mean and the slowest of the per thread results.
+   */
+  double mean;
+  double max;
+
+  /**
+   * the operations completed per nano-second by all the threads together.
+   */
+  double aggregate_rate;
+};
+
+/**
+ * runs measure on num_threads pinned threads at once.
+ * @param measure a measurement function with the osm_*_time signature
+ * @param iterations passed to every call of measure
+ * @param num_threads number of threads
+ * @param result receives the per thread and aggregate results
+ * @return 0 upon success and -1 upon failure
+ */
+int osm_parallel_run (osm_measure measure, unsigned int iterations, unsigned int num_threads,
+                      ParallelResult *result);
+
+/* Time measurement function for an atomic increment of one counter shared by
+   num_threads threads.
+   returns time in nano-seconds upon success,
+   and -1 upon failure.
+   */
+double osm_shared_atomic_time (unsigned int num_threads, unsigned int iterations);
+
+/* Time measurement function for an atomic increment of a private counter that has a
+   cache line of its own, run on num_threads threads at once.
+   returns time in nano-seconds upon success,
+   and -1 upon failure.
+   */
+double osm_padded_atomic_time (unsigned int num_threads, unsigned int iterations);
+
+/* Time measurement function for a plain increment of a private counter that shares a
+   cache line with the counters of the other num_threads - 1 threads.
+   returns time in nano-seconds upon success,
+   and -1 upon failure.
+   */
+double osm_false_sharing_time (unsigned int num_threads, unsigned int iterations);
+
+/* Time measurement function for moving a cache line between two cpus, measured as
+   half of a ping-pong round trip on a shared flag.
+   returns time in nano-seconds upon success,
+   and -1 upon failure.
+   */
+double osm_cacheline_transfer_time (int cpu_a, int cpu_b, unsigned int iterations);
+
+/* osm_cacheline_transfer_time between two cpus of the same NUMA node.
+   returns -1 if no node has two cpus the caller may use.
+   */
+double osm_local_transfer_time (unsigned int iterations);
+
+/* osm_cacheline_transfer_time between cpus of two different NUMA nodes (sockets).
+   returns -1 on a single node machine.
+   */
+double osm_remote_transfer_time (unsigned int iterations);
+
+#endif //_PARALLEL_H_
@@ -0,0 +1,245 @@
+#include "Syscall.h"
+#include "Measure.h"
+#include <algorithm>
+#include <cstring>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#endif
+
+#define SUCCESS 0
+#define FAILURE (-1)
+#define BATCH_1 1
+#define BATCH_8 8
+#define BATCH_32 32
+
+using namespace std;
+
+double osm_vdso_clock_gettime_time (unsigned int iterations)
+{
+  if (iterations == 0)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  struct timespec now{};
+  unsigned int rounds = loop_rounds (iterations);
+  uint64_t ticks;
+  TIME_LOOP (rounds, clock_gettime (CLOCK_MONOTONIC, &now), ticks);
+  return ticks_per_op_ns (ticks, rounds);
+}
+
+double osm_vdso_getcpu_time (unsigned int iterations)
+{
+  if (iterations == 0)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  unsigned int rounds = loop_rounds (iterations);
+  uint64_t ticks;
+  TIME_LOOP (rounds, sched_getcpu (), ticks);
+  return ticks_per_op_ns (ticks, rounds);
+}
+
+double osm_getppid_time (unsigned int iterations)
+{
+  if (iterations == 0)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  unsigned int rounds = loop_rounds (iterations);
+  uint64_t ticks;
+  TIME_LOOP (rounds, getppid (), ticks);
+  return ticks_per_op_ns (ticks, rounds);
+}
+
+double osm_raw_getpid_time (unsigned int iterations)
+{
+  if (iterations == 0)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  unsigned int rounds = loop_rounds (iterations);
+  uint64_t ticks;
+  TIME_LOOP (rounds, syscall (SYS_getpid), ticks);
+  return ticks_per_op_ns (ticks, rounds);
+}
+
+#if defined(__NR_io_uring_setup)
+
+/**
+ * an io_uring instance with its submission and completion rings mapped.
+ */
+struct Uring {
+  int fd;
+  void *sq_ring;
+  size_t sq_ring_len;
+  void *cq_ring;
+  size_t cq_ring_len;
+  io_uring_sqe *sqes;
+  size_t sqes_len;
+  unsigned int *sq_tail;
+  unsigned int *sq_mask;
+  unsigned int *sq_array;
+  unsigned int *cq_head;
+  unsigned int *cq_tail;
+};
+
+/**
+ * unmaps the rings and closes the instance.
+ * @param ring the instance
+ */
+static void uring_close (Uring *ring)
+{
+  if (ring->sqes != nullptr)
+    {
+      munmap (ring->sqes, ring->sqes_len);
+    }
+  if (ring->cq_ring != nullptr && ring->cq_ring != ring->sq_ring)
+    {
+      munmap (ring->cq_ring, ring->cq_ring_len);
+    }
+  if (ring->sq_ring != nullptr)
+    {
+      munmap (ring->sq_ring, ring->sq_ring_len);
+    }
+  close (ring->fd);
+}
+
+/**
+ * maps a region of an io_uring instance.
+ * @return the mapping, or nullptr upon failure
+ */
+static void *uring_map (int fd, size_t length, off_t offset)
+{
+  void *mem = mmap (nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+  return mem == MAP_FAILED ? nullptr : mem;
+}
+
+/**
+ * creates an io_uring instance with room for entries submissions.
+ * @param ring the instance to fill
+ * @param entries the submission ring size
+ * @return 0 upon success and -1 upon failure
+ */
+static int uring_open (Uring *ring, unsigned int entries)
+{
+  io_uring_params params{};
+  memset (ring, 0, sizeof (*ring));
+  ring->fd = (int) syscall (__NR_io_uring_setup, entries, &params);
+  if (ring->fd < SUCCESS)
+    {
+      return FAILURE;
+    }
+  ring->sq_ring_len = params.sq_off.array + params.sq_entries * sizeof (unsigned int);
+  ring->cq_ring_len = params.cq_off.cqes + params.cq_entries * sizeof (io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+      ring->sq_ring_len = ring->cq_ring_len = max (ring->sq_ring_len, ring->cq_ring_len);
+    }
+  ring->sq_ring = uring_map (ring->fd, ring->sq_ring_len, IORING_OFF_SQ_RING);
+  ring->cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP) ? ring->sq_ring
+                  : uring_map (ring->fd, ring->cq_ring_len, IORING_OFF_CQ_RING);
+  ring->sqes_len = params.sq_entries * sizeof (io_uring_sqe);
+  ring->sqes = (io_uring_sqe *) uring_map (ring->fd, ring->sqes_len, IORING_OFF_SQES);
+  if (ring->sq_ring == nullptr || ring->cq_ring == nullptr || ring->sqes == nullptr)
+    {
+      uring_close (ring);
+      return FAILURE;
+    }
+  char *sq = (char *) ring->sq_ring;
+  char *cq = (char *) ring->cq_ring;
+  ring->sq_tail = (unsigned int *) (sq + params.sq_off.tail);
+  ring->sq_mask = (unsigned int *) (sq + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned int *) (sq + params.sq_off.array);
+  ring->cq_head = (unsigned int *) (cq + params.cq_off.head);
+  ring->cq_tail = (unsigned int *) (cq + params.cq_off.tail);
+  return SUCCESS;
+}
+
+/**
+ * queues batch NOPs, submits them with one io_uring_enter and reaps their completions.
+ * @param ring the instance
+ * @param batch number of NOPs
+ * @return 0 upon success and -1 upon failure
+ */
+static int uring_nop_batch (Uring *ring, unsigned int batch)
+{
+  unsigned int tail = *ring->sq_tail;
+  unsigned int mask = *ring->sq_mask;
+  for (unsigned int i = 0; i < batch; i++, tail++)
+    {
+      unsigned int index = tail & mask;
+      io_uring_sqe *sqe = &ring->sqes[index];
+      memset (sqe, 0, sizeof (*sqe));
+      sqe->opcode = IORING_OP_NOP;
+      ring->sq_array[index] = index;
+    }
+  __atomic_store_n (ring->sq_tail, tail, __ATOMIC_RELEASE);
+  if (syscall (__NR_io_uring_enter, ring->fd, batch, batch, IORING_ENTER_GETEVENTS, nullptr, 0) < SUCCESS)
+    {
+      return FAILURE;
+    }
+  unsigned int head = *ring->cq_head;
+  unsigned int ready = __atomic_load_n (ring->cq_tail, __ATOMIC_ACQUIRE) - head;
+  __atomic_store_n (ring->cq_head, head + ready, __ATOMIC_RELEASE);
+  return ready == batch ? SUCCESS : FAILURE;
+}
+
+double osm_io_uring_nop_time (unsigned int batch, unsigned int iterations)
+{
+  if (iterations == 0 || batch == 0 || batch > MAX_URING_BATCH)
+    {
+      return FAILURE;
+    }
+  init_clock ();
+  Uring ring{};
+  if (uring_open (&ring, batch) < SUCCESS)
+    {
+      return FAILURE;
+    }
+  unsigned int rounds = iterations / batch + (iterations % batch != 0);
+  int ret_val = SUCCESS;
+  uint64_t start = read_clock ();
+  for (unsigned int round = 0; round < rounds && ret_val == SUCCESS; round++)
+    {
+      ret_val = uring_nop_batch (&ring, batch);
+    }
+  uint64_t end = read_clock ();
+  uring_close (&ring);
+  if (ret_val == FAILURE)
+    {
+      return FAILURE;
+    }
+  return ticks_to_ns ((double) (end - start)) / ((double) rounds * batch);
+}
+
+#else
+
+double osm_io_uring_nop_time (unsigned int batch, unsigned int iterations)
+{
+  return FAILURE;
+}
+
+#endif
+
+double osm_io_uring_nop1_time (unsigned int iterations)
+{
+  return osm_io_uring_nop_time (BATCH_1, iterations);
+}
+
+double osm_io_uring_nop8_time (unsigned int iterations)
+{
+  return osm_io_uring_nop_time (BATCH_8, iterations);
+}
+
+double osm_io_uring_nop32_time (unsigned int iterations)
+{
+  return osm_io_uring_nop_time (BATCH_32, iterations);
+}
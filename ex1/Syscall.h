@@ -0,0 +1,57 @@
+#ifndef _SYSCALL_H_
+#define _SYSCALL_H_
+
+/*
+ * Measurements that separate the cost of entering the kernel from the work of a
+ * system call: calls served by the vDSO without a trap, real traps, and io_uring
+ * NOP submissions that pay one kernel entry for a whole batch.
+ */
+
+/**
+ * the largest batch osm_io_uring_nop_time accepts.
+ */
+#define MAX_URING_BATCH 256
+
+/* Time measurement function for clock_gettime(CLOCK_MONOTONIC), served by the vDSO.
+   returns time in nano-seconds upon success,
+   and -1 upon failure.
+   */
+double osm_vdso_clock_gettime_time (unsigned int iterations);
+
+/* Time measurement function for sched_getcpu, served by the vDSO getcpu (or by rseq
+   on recent glibc versions).
+   returns time in nano-seconds upon success,
+   and -1 upon failure.
+   */
+double osm_vdso_getcpu_time (unsigned int iterations);
+
+/* Time measurement function for getppid, which always traps into the kernel.
+   returns time in nano-seconds upon success,
+   and -1 upon failure.
+   */
+double osm_getppid_time (unsigned int iterations);
+
+/* Time measurement function for syscall(SYS_getpid), a raw trap that bypasses any
+   caching in the C library.
+   returns time in nano-seconds upon success,
+   and -1 upon failure.
+   */
+double osm_raw_getpid_time (unsigned int iterations);
+
+/* Time measurement function for io_uring NOP requests, submitted and reaped batch
+   at a time with a single io_uring_enter call.
+   returns the time of one NOP in nano-seconds upon success,
+   and -1 upon failure (including kernels without io_uring or where it is disabled).
+   */
+double osm_io_uring_nop_time (unsigned int batch, unsigned int iterations);
+
+/* osm_io_uring_nop_time with one NOP per io_uring_enter. */
+double osm_io_uring_nop1_time (unsigned int iterations);
+
+/* osm_io_uring_nop_time with 8 NOPs per io_uring_enter. */
+double osm_io_uring_nop8_time (unsigned int iterations);
+
+/* osm_io_uring_nop_time with 32 NOPs per io_uring_enter. */
+double osm_io_uring_nop32_time (unsigned int iterations);
+
+#endif //_SYSCALL_H_
@@ -1,10 +1,12 @@
 #include <iostream>
 #include "osm.h"
-#include <sys/time.h>
+#include "Measure.h"
+#include "Operation.h"
 
 
 
-/* Time measurement function for a simple arithmetic operation.
+/* Time measurement function for a simple arithmetic operation: a dependent chain of
+   additions, see osm_instruction_time for the other kinds and modes.
    returns time in nano-seconds upon success,
    and -1 upon failure.
    */
@@ -14,28 +16,16 @@ double osm_operation_time (unsigned int iterations)
     {
       return - 1;
     }
-  int x;
-  double sum = 0;
-  struct timeval start_time{};
-  struct timeval end_time{};
-  for (unsigned int i = 0; i < iterations; i += 5)
-    {
-      gettimeofday (&start_time, nullptr);
-      x = x + 7;
-      x = x - 7;
-      x = x + 7;
-      x = x - 7;
-      x = x + 7;
-      gettimeofday (&end_time, nullptr);
-      sum += (end_time.tv_sec - start_time.tv_sec)*1000000000 + (end_time.tv_usec - start_time.tv_usec)*1000;
-    }
-  return (sum / iterations);
+  return osm_instruction_time (iterations, OP_ADD, OP_LATENCY);
 }
 
 /**
- * empty function call
+ * empty function call, kept out of line so the loop really calls it
  */
-void empty_func (){}
+__attribute__((noinline)) void empty_func ()
+{
+  COMPILER_BARRIER ();
+}
 
 /* Time measurement function for an empty function call.
    returns time in nano-seconds upon success,
@@ -47,21 +37,11 @@ double osm_function_time (unsigned int iterations)
     {
       return - 1;
     }
-  double sum = 0;
-  struct timeval start_time{};
-  struct timeval end_time{};
-  for (unsigned int i = 0; i < iterations; i += 5)
-    {
-      gettimeofday (&start_time, nullptr);
-      empty_func ();
-      empty_func ();
-      empty_func ();
-      empty_func ();
-      empty_func ();
-      gettimeofday (&end_time, nullptr);
-      sum += (end_time.tv_sec - start_time.tv_sec)*1000000000 + (end_time.tv_usec - start_time.tv_usec)*1000;
-    }
-  return (sum / iterations);
+  init_clock ();
+  unsigned int rounds = loop_rounds (iterations);
+  uint64_t ticks;
+  TIME_LOOP (rounds, empty_func (), ticks);
+  return ticks_per_op_ns (ticks, rounds);
 }
 
 /* Time measurement function for an empty trap into the operating system.
@@ -74,21 +54,10 @@ double osm_syscall_time (unsigned int iterations)
     {
       return - 1;
     }
-  double sum = 0;
-  struct timeval start_time{};
-  struct timeval end_time{};
-  for (unsigned int i = 0; i < iterations; i += 5)
-    {
-      gettimeofday (&start_time, nullptr);
-      OSM_NULLSYSCALL;
-      OSM_NULLSYSCALL;
-      OSM_NULLSYSCALL;
-      OSM_NULLSYSCALL;
-      OSM_NULLSYSCALL;
-      gettimeofday (&end_time, nullptr);
-      sum += (end_time.tv_sec - start_time.tv_sec)*1000000000 + (end_time.tv_usec - start_time.tv_usec)*1000;
-    }
-  return (sum / iterations);
+  init_clock ();
+  unsigned int rounds = loop_rounds (iterations);
+  uint64_t ticks;
+  TIME_LOOP (rounds, OSM_NULLSYSCALL, ticks);
+  return ticks_per_op_ns (ticks, rounds);
 }
 
-
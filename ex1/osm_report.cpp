@@ -0,0 +1,651 @@
+#include "osm.h"
+#include "Harness.h"
+#include "MicroBench.h"
+#include "Syscall.h"
+#include "Parallel.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#define SUCCESS 0
+#define FAILURE (-1)
+#define REGRESSION 1
+#define USAGE_ERROR 2
+#define HOST_NAME_LEN 256
+#define DEFAULT_THRESHOLD 10.0
+#define T_CRITICAL 3.0
+#define PERCENTAGE 100
+#define UNKNOWN "unknown"
+#define NS "ns"
+#define GBPS "GB/s"
+#define CPUINFO_PATH "/proc/cpuinfo"
+#define CPU_MODEL_KEY "model name"
+#define GOVERNOR_PATH "/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor"
+#define CSV_HEADER "name,unit,samples,min,median,p90,p99,max,mean,stddev,ci_low,ci_high,host,kernel,cpu,governor"
+#define USAGE "usage: osm_report run [--json FILE] [--csv FILE] [--trials N] [--cpu N] [--reject-outliers]\n" \
+              "       osm_report compare BASELINE.csv CURRENT.csv [--threshold PERCENT]\n" \
+              "       osm_report syscalls [--trials N] [--cpu N]\n" \
+              "       osm_report scaling [--threads N]"
+
+using namespace std;
+
+/**
+ * a measurement of the suite.
+ */
+struct Benchmark {
+  const char *name;
+  osm_measure measure;
+  unsigned int iterations;
+  const char *unit;
+};
+
+/**
+ * the measurements the scaling mode runs on all the threads at once.
+ */
+static const Benchmark SCALING[] = {
+    {"operation", &osm_operation_time, 1000000, NS},
+    {"function", &osm_function_time, 1000000, NS},
+    {"syscall", &osm_syscall_time, 100000, NS},
+    {"minor_fault", &osm_minor_fault_time, 10000, NS},
+    {"l3_latency", &osm_l3_latency, 1000000, NS},
+    {"dram_latency", &osm_dram_latency, 1000000, NS},
+};
+
+/**
+ * the number of increments of every thread in the contention probes.
+ */
+#define CONTENTION_ITERATIONS 1000000
+
+/**
+ * the number of round trips of the cache line transfer probes.
+ */
+#define TRANSFER_ITERATIONS 100000
+
+/**
+ * every measurement the driver runs, in order.
+ */
+static const Benchmark SUITE[] = {
+    {"operation", &osm_operation_time, 1000000, NS},
+    {"function", &osm_function_time, 1000000, NS},
+    {"syscall", &osm_syscall_time, 100000, NS},
+    {"process_switch", &osm_process_switch_time, 10000, NS},
+    {"thread_switch", &osm_thread_switch_time, 10000, NS},
+    {"minor_fault", &osm_minor_fault_time, 10000, NS},
+    {"major_fault", &osm_major_fault_time, 1000, NS},
+    {"l1_latency", &osm_l1_latency, 1000000, NS},
+    {"l2_latency", &osm_l2_latency, 1000000, NS},
+    {"l3_latency", &osm_l3_latency, 1000000, NS},
+    {"dram_latency", &osm_dram_latency, 1000000, NS},
+    {"memory_bandwidth", &osm_memory_bandwidth, 2, GBPS},
+    {"futex_wake", &osm_futex_wake_time, 10000, NS},
+    {"vdso_clock_gettime", &osm_vdso_clock_gettime_time, 1000000, NS},
+    {"vdso_getcpu", &osm_vdso_getcpu_time, 1000000, NS},
+    {"getppid", &osm_getppid_time, 100000, NS},
+    {"raw_getpid", &osm_raw_getpid_time, 100000, NS},
+    {"io_uring_nop_batch1", &osm_io_uring_nop1_time, 100000, NS},
+    {"io_uring_nop_batch8", &osm_io_uring_nop8_time, 100000, NS},
+    {"io_uring_nop_batch32", &osm_io_uring_nop32_time, 100000, NS},
+};
+
+/**
+ * the entry points compared by the syscalls mode, the first one is the reference trap.
+ */
+static const Benchmark SYSCALL_PATHS[] = {
+    {"getppid (trap)", &osm_getppid_time, 100000, NS},
+    {"syscall(SYS_getpid) (trap)", &osm_raw_getpid_time, 100000, NS},
+    {"clock_gettime (vDSO)", &osm_vdso_clock_gettime_time, 1000000, NS},
+    {"sched_getcpu (vDSO)", &osm_vdso_getcpu_time, 1000000, NS},
+    {"io_uring NOP, batch 1", &osm_io_uring_nop1_time, 100000, NS},
+    {"io_uring NOP, batch 8", &osm_io_uring_nop8_time, 100000, NS},
+    {"io_uring NOP, batch 32", &osm_io_uring_nop32_time, 100000, NS},
+};
+
+/**
+ * the machine a report was produced on.
+ */
+struct HostInfo {
+  string host;
+  string kernel;
+  string cpu;
+  string governor;
+};
+
+/**
+ * a row of a report.
+ */
+struct Record {
+  string name;
+  string unit;
+  BenchStats stats;
+};
+
+//------------------------------host info------------------------------------
+
+/**
+ * reads the first line of a file.
+ * @param path the file path
+ * @return the line, or UNKNOWN if the file cannot be read
+ */
+static string first_line (const char *path)
+{
+  ifstream file (path);
+  string line;
+  if (!getline (file, line) || line.empty ())
+    {
+      return UNKNOWN;
+    }
+  return line;
+}
+
+/**
+ * finds the cpu model in /proc/cpuinfo.
+ * @return the cpu model, or UNKNOWN
+ */
+static string cpu_model ()
+{
+  ifstream file (CPUINFO_PATH);
+  string line;
+  while (getline (file, line))
+    {
+      if (line.compare (0, strlen (CPU_MODEL_KEY), CPU_MODEL_KEY) == 0)
+        {
+          size_t colon = line.find (':');
+          if (colon != string::npos && colon + 2 <= line.size ())
+            {
+              return line.substr (colon + 2);
+            }
+        }
+    }
+  return UNKNOWN;
+}
+
+/**
+ * collects the host name, kernel, cpu model and frequency governor.
+ */
+static HostInfo host_info ()
+{
+  HostInfo info;
+  char name[HOST_NAME_LEN] = {};
+  info.host = gethostname (name, sizeof (name) - 1) == SUCCESS ? name : UNKNOWN;
+  struct utsname uts{};
+  info.kernel = uname (&uts) == SUCCESS ? string (uts.release) + " " + uts.version : UNKNOWN;
+  info.cpu = cpu_model ();
+  info.governor = first_line (GOVERNOR_PATH);
+  return info;
+}
+
+//------------------------------output---------------------------------------
+
+/**
+ * escapes a string for a JSON document.
+ */
+static string json_string (const string &value)
+{
+  string out = "\"";
+  for (char c : value)
+    {
+      if (c == '"' || c == '\\')
+        {
+          out += '\\';
+        }
+      if ((unsigned char) c >= ' ')
+        {
+          out += c;
+        }
+    }
+  return out + "\"";
+}
+
+/**
+ * quotes a string for a CSV file.
+ */
+static string csv_string (const string &value)
+{
+  string out = "\"";
+  for (char c : value)
+    {
+      if (c == '"')
+        {
+          out += '"';
+        }
+      out += c;
+    }
+  return out + "\"";
+}
+
+/**
+ * writes a report as a JSON document.
+ */
+static void write_json (ostream &out, const HostInfo &info, const vector<Record> &records)
+{
+  out << "{\n  \"host\": " << json_string (info.host) << ",\n  \"kernel\": " << json_string (info.kernel)
+      << ",\n  \"cpu\": " << json_string (info.cpu) << ",\n  \"governor\": " << json_string (info.governor)
+      << ",\n  \"results\": [";
+  for (size_t i = 0; i < records.size (); i++)
+    {
+      const BenchStats &s = records[i].stats;
+      out << (i == 0 ? "\n" : ",\n") << "    {\"name\": " << json_string (records[i].name)
+          << ", \"unit\": " << json_string (records[i].unit) << ", \"samples\": " << s.samples
+          << ", \"min\": " << s.min << ", \"median\": " << s.median << ", \"p90\": " << s.p90
+          << ", \"p99\": " << s.p99 << ", \"max\": " << s.max << ", \"mean\": " << s.mean
+          << ", \"stddev\": " << s.stddev << ", \"ci_low\": " << s.ci_low << ", \"ci_high\": " << s.ci_high << "}";
+    }
+  out << "\n  ]\n}\n";
+}
+
+/**
+ * writes a report as a CSV file, one row per measurement.
+ */
+static void write_csv (ostream &out, const HostInfo &info, const vector<Record> &records)
+{
+  out << CSV_HEADER << "\n";
+  for (const Record &record : records)
+    {
+      const BenchStats &s = record.stats;
+      out << record.name << "," << record.unit << "," << s.samples << "," << s.min << "," << s.median << ","
+          << s.p90 << "," << s.p99 << "," << s.max << "," << s.mean << "," << s.stddev << "," << s.ci_low << ","
+          << s.ci_high << "," << csv_string (info.host) << "," << csv_string (info.kernel) << ","
+          << csv_string (info.cpu) << "," << csv_string (info.governor) << "\n";
+    }
+}
+
+//------------------------------input----------------------------------------
+
+/**
+ * splits a CSV line into its fields, handling quoted fields.
+ */
+static vector<string> csv_fields (const string &line)
+{
+  vector<string> fields (1);
+  bool quoted = false;
+  for (size_t i = 0; i < line.size (); i++)
+    {
+      char c = line[i];
+      if (quoted && c == '"' && i + 1 < line.size () && line[i + 1] == '"')
+        {
+          fields.back () += c;
+          i++;
+        }
+      else if (c == '"')
+        {
+          quoted = !quoted;
+        }
+      else if (c == ',' && !quoted)
+        {
+          fields.emplace_back ();
+        }
+      else
+        {
+          fields.back () += c;
+        }
+    }
+  return fields;
+}
+
+/**
+ * reads a CSV report written by write_csv.
+ * @param path the report path
+ * @param records receives the records by name
+ * @return 0 upon success and -1 upon failure
+ */
+static int read_csv (const char *path, map<string, Record> &records)
+{
+  ifstream file (path);
+  string line;
+  if (!getline (file, line) || line != CSV_HEADER)
+    {
+      cerr << "osm_report: " << path << " is not an osm_report CSV file" << endl;
+      return FAILURE;
+    }
+  while (getline (file, line))
+    {
+      vector<string> fields = csv_fields (line);
+      if (fields.size () < 12)
+        {
+          continue;
+        }
+      Record record;
+      record.name = fields[0];
+      record.unit = fields[1];
+      record.stats.samples = strtoul (fields[2].c_str (), nullptr, 10);
+      record.stats.rejected = 0;
+      double *values[] = {&record.stats.min, &record.stats.median, &record.stats.p90, &record.stats.p99,
+                          &record.stats.max, &record.stats.mean, &record.stats.stddev, &record.stats.ci_low,
+                          &record.stats.ci_high};
+      for (size_t i = 0; i < sizeof (values) / sizeof (values[0]); i++)
+        {
+          *values[i] = strtod (fields[3 + i].c_str (), nullptr);
+        }
+      records[record.name] = record;
+    }
+  return SUCCESS;
+}
+
+/**
+ * closes a report file and checks that it was opened and fully written.
+ * @param file the report file
+ * @param path the report path
+ * @return 0 upon success and -1 upon failure
+ */
+static int check_written (ofstream &file, const char *path)
+{
+  file.close ();
+  if (file.fail ())
+    {
+      cerr << "osm_report: cannot write " << path << endl;
+      return FAILURE;
+    }
+  return SUCCESS;
+}
+
+/**
+ * parses the argument of --cpu.
+ * @param text the argument
+ * @param cpu receives the cpu
+ * @return 0 upon success and -1 if it is not a cpu number CPU_SET accepts
+ */
+static int parse_cpu (const char *text, int *cpu)
+{
+  char *end = nullptr;
+  long value = strtol (text, &end, 10);
+  if (end == text || *end != '\0' || value < 0 || value >= CPU_SETSIZE)
+    {
+      cerr << "osm_report: bad cpu " << text << endl;
+      return FAILURE;
+    }
+  *cpu = (int) value;
+  return SUCCESS;
+}
+
+//------------------------------modes----------------------------------------
+
+/**
+ * runs every measurement of the suite under the harness and writes the report.
+ */
+static int run_mode (int argc, char **argv)
+{
+  HarnessConfig config = default_harness_config ();
+  const char *json_path = nullptr;
+  const char *csv_path = nullptr;
+  for (int arg = 2; arg < argc; arg++)
+    {
+      if (strcmp (argv[arg], "--json") == 0 && arg + 1 < argc)
+        {
+          json_path = argv[++arg];
+        }
+      else if (strcmp (argv[arg], "--csv") == 0 && arg + 1 < argc)
+        {
+          csv_path = argv[++arg];
+        }
+      else if (strcmp (argv[arg], "--trials") == 0 && arg + 1 < argc)
+        {
+          config.trials = strtoul (argv[++arg], nullptr, 10);
+        }
+      else if (strcmp (argv[arg], "--cpu") == 0 && arg + 1 < argc)
+        {
+          if (parse_cpu (argv[++arg], &config.cpu) < SUCCESS)
+            {
+              return USAGE_ERROR;
+            }
+        }
+      else if (strcmp (argv[arg], "--reject-outliers") == 0)
+        {
+          config.reject_outliers = true;
+        }
+      else
+        {
+          cerr << USAGE << endl;
+          return USAGE_ERROR;
+        }
+    }
+  vector<Record> records;
+  for (const Benchmark &bench : SUITE)
+    {
+      Record record;
+      record.name = bench.name;
+      record.unit = bench.unit;
+      if (osm_harness_run (bench.measure, bench.iterations, config, &record.stats) < SUCCESS)
+        {
+          cerr << "osm_report: " << bench.name << " failed, skipped" << endl;
+          continue;
+        }
+      records.push_back (record);
+    }
+  HostInfo info = host_info ();
+  int status = SUCCESS;
+  if (json_path != nullptr)
+    {
+      ofstream json (json_path);
+      write_json (json, info, records);
+      status = min (status, check_written (json, json_path));
+    }
+  if (csv_path != nullptr)
+    {
+      ofstream csv (csv_path);
+      write_csv (csv, info, records);
+      status = min (status, check_written (csv, csv_path));
+    }
+  if (json_path == nullptr && csv_path == nullptr)
+    {
+      write_csv (cout, info, records);
+    }
+  return status < SUCCESS ? USAGE_ERROR : SUCCESS;
+}
+
+/**
+ * checks if the current record is a statistically significant regression of the
+ * baseline by more than threshold percent, using Welch's t-test on the means.
+ * @param base the baseline record
+ * @param cur the current record
+ * @param threshold the allowed slowdown in percent
+ * @param change receives the slowdown in percent, negative for an improvement
+ * @return true for a regression
+ */
+static bool is_regression (const Record &base, const Record &cur, double threshold, double *change)
+{
+  bool higher_is_better = base.unit == GBPS;
+  double diff = higher_is_better ? base.stats.mean - cur.stats.mean : cur.stats.mean - base.stats.mean;
+  *change = base.stats.mean == 0 ? 0 : diff / base.stats.mean * PERCENTAGE;
+  double base_var = base.stats.stddev * base.stats.stddev / max (base.stats.samples, 1u);
+  double cur_var = cur.stats.stddev * cur.stats.stddev / max (cur.stats.samples, 1u);
+  double error = sqrt (base_var + cur_var);
+  bool significant = error == 0 ? diff != 0 : diff / error > T_CRITICAL;
+  return significant && *change > threshold;
+}
+
+/**
+ * compares a current report against a baseline and lists the regressions.
+ */
+static int compare_mode (int argc, char **argv)
+{
+  if (argc < 4)
+    {
+      cerr << USAGE << endl;
+      return USAGE_ERROR;
+    }
+  double threshold = DEFAULT_THRESHOLD;
+  for (int arg = 4; arg < argc; arg++)
+    {
+      if (strcmp (argv[arg], "--threshold") == 0 && arg + 1 < argc)
+        {
+          threshold = strtod (argv[++arg], nullptr);
+        }
+      else
+        {
+          cerr << USAGE << endl;
+          return USAGE_ERROR;
+        }
+    }
+  map<string, Record> baseline;
+  map<string, Record> current;
+  if (read_csv (argv[2], baseline) < SUCCESS || read_csv (argv[3], current) < SUCCESS)
+    {
+      return USAGE_ERROR;
+    }
+  int regressions = 0;
+  for (const auto &entry : current)
+    {
+      auto base = baseline.find (entry.first);
+      if (base == baseline.end ())
+        {
+          cout << entry.first << ": new, no baseline" << endl;
+          continue;
+        }
+      double change;
+      bool regressed = is_regression (base->second, entry.second, threshold, &change);
+      regressions += regressed;
+      cout << entry.first << ": " << base->second.stats.mean << " -> " << entry.second.stats.mean << " "
+           << entry.second.unit << " (" << (change > 0 ? "+" : "") << change << "% slower)"
+           << (regressed ? " REGRESSION" : "") << endl;
+    }
+  for (const auto &entry : baseline)
+    {
+      if (current.find (entry.first) == current.end ())
+        {
+          cout << entry.first << ": missing from the current report REGRESSION" << endl;
+          regressions++;
+        }
+    }
+  return regressions > 0 ? REGRESSION : SUCCESS;
+}
+
+/**
+ * compares the per call cost of vDSO calls, real traps and batched io_uring
+ * submissions, relative to a getppid trap. Fails if the trap itself cannot be measured.
+ */
+static int syscalls_mode (int argc, char **argv)
+{
+  HarnessConfig config = default_harness_config ();
+  for (int arg = 2; arg < argc; arg++)
+    {
+      if (strcmp (argv[arg], "--trials") == 0 && arg + 1 < argc)
+        {
+          config.trials = strtoul (argv[++arg], nullptr, 10);
+        }
+      else if (strcmp (argv[arg], "--cpu") == 0 && arg + 1 < argc)
+        {
+          if (parse_cpu (argv[++arg], &config.cpu) < SUCCESS)
+            {
+              return USAGE_ERROR;
+            }
+        }
+      else
+        {
+          cerr << USAGE << endl;
+          return USAGE_ERROR;
+        }
+    }
+  double trap = 0;
+  for (const Benchmark &path : SYSCALL_PATHS)
+    {
+      BenchStats stats{};
+      bool measured = osm_harness_run (path.measure, path.iterations, config, &stats) == SUCCESS;
+      if (&path == SYSCALL_PATHS)
+        {
+          // the other paths are only meaningful relative to the reference trap
+          if (!measured || stats.median <= 0)
+            {
+              cerr << "osm_report: the reference trap " << path.name << " failed" << endl;
+              return USAGE_ERROR;
+            }
+          trap = stats.median;
+        }
+      if (!measured)
+        {
+          cout << path.name << ": unavailable" << endl;
+          continue;
+        }
+      cout << path.name << ": " << stats.median << " ns per call, " << stats.median / trap
+           << " of a trap" << endl;
+    }
+  return SUCCESS;
+}
+
+/**
+ * prints a contention probe on one thread and on num_threads threads.
+ */
+static void print_probe (const char *name, double (*probe) (unsigned int, unsigned int), unsigned int num_threads)
+{
+  cout << name << ": " << probe (1, CONTENTION_ITERATIONS) << " ns alone, "
+       << probe (num_threads, CONTENTION_ITERATIONS) << " ns on " << num_threads << " threads" << endl;
+}
+
+/**
+ * runs measurements on several pinned threads at once and prints the per core and
+ * aggregate results, followed by the contention probes.
+ */
+static int scaling_mode (int argc, char **argv)
+{
+  unsigned int num_threads = sysconf (_SC_NPROCESSORS_ONLN);
+  for (int arg = 2; arg < argc; arg++)
+    {
+      if (strcmp (argv[arg], "--threads") == 0 && arg + 1 < argc)
+        {
+          num_threads = strtoul (argv[++arg], nullptr, 10);
+        }
+      else
+        {
+          cerr << USAGE << endl;
+          return USAGE_ERROR;
+        }
+    }
+  for (const Benchmark &bench : SCALING)
+    {
+      ParallelResult result;
+      if (osm_parallel_run (bench.measure, bench.iterations, num_threads, &result) < SUCCESS)
+        {
+          cout << bench.name << ": failed" << endl;
+          continue;
+        }
+      cout << bench.name << ":";
+      for (size_t thread = 0; thread < result.per_thread.size (); thread++)
+        {
+          cout << " cpu" << result.cpus[thread] << "=" << result.per_thread[thread];
+        }
+      cout << " | mean " << result.mean << " ns, max " << result.max << " ns, aggregate "
+           << result.aggregate_rate << " ops/ns" << endl;
+    }
+  print_probe ("shared_atomic", &osm_shared_atomic_time, num_threads);
+  print_probe ("padded_atomic", &osm_padded_atomic_time, num_threads);
+  print_probe ("false_sharing", &osm_false_sharing_time, num_threads);
+  double local = osm_local_transfer_time (TRANSFER_ITERATIONS);
+  double remote = osm_remote_transfer_time (TRANSFER_ITERATIONS);
+  cout << "cacheline_transfer: " << (local < 0 ? "n/a" : to_string (local) + " ns") << " within a node, "
+       << (remote < 0 ? "n/a" : to_string (remote) + " ns") << " across nodes" << endl;
+  return SUCCESS;
+}
+
+/**
+ * runs the osm suite and writes a report, or compares two reports.
+ * exits with 1 when compare finds a regression and 2 upon a usage error.
+ */
+int main (int argc, char **argv)
+{
+  if (argc >= 2 && strcmp (argv[1], "run") == 0)
+    {
+      return run_mode (argc, argv);
+    }
+  if (argc >= 2 && strcmp (argv[1], "compare") == 0)
+    {
+      return compare_mode (argc, argv);
+    }
+  if (argc >= 2 && strcmp (argv[1], "syscalls") == 0)
+    {
+      return syscalls_mode (argc, argv);
+    }
+  if (argc >= 2 && strcmp (argv[1], "scaling") == 0)
+    {
+      return scaling_mode (argc, argv);
+    }
+  cerr << USAGE << endl;
+  return USAGE_ERROR;
+}
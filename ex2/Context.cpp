@@ -0,0 +1,60 @@
+#include "Context.h"
+#include <cstdint>
+
+#define STACK_ALIGN 16
+#define CALLEE_SAVED 6
+#define DEFAULT_MXCSR 0x1F80
+#define DEFAULT_FPU_CW 0x037F
+#define FPU_CW_SHIFT 32
+
+//-------------------context switch--------------------------------
+// frame saved on the stack, from the saved sp upwards:
+// mxcsr and the x87 control word, r15, r14, r13, r12, rbx, rbp, return address.
+asm(".text\n"
+    ".globl context_switch\n"
+    ".type context_switch, @function\n"
+    "context_switch:\n"
+    "  pushq %rbp\n"
+    "  pushq %rbx\n"
+    "  pushq %r12\n"
+    "  pushq %r13\n"
+    "  pushq %r14\n"
+    "  pushq %r15\n"
+    "  subq $8, %rsp\n"
+    "  stmxcsr (%rsp)\n"
+    "  fnstcw 4(%rsp)\n"
+    "  movq %rsp, (%rdi)\n"
+    "  movq (%rsi), %rsp\n"
+    "  ldmxcsr (%rsp)\n"
+    "  fldcw 4(%rsp)\n"
+    "  addq $8, %rsp\n"
+    "  popq %r15\n"
+    "  popq %r14\n"
+    "  popq %r13\n"
+    "  popq %r12\n"
+    "  popq %rbx\n"
+    "  popq %rbp\n"
+    "  ret\n"
+    ".size context_switch, .-context_switch\n");
+//-----------------------------------------------------------------
+
+/**
+ * prepares a context that starts running start on the given stack.
+ * @param context the context to prepare
+ * @param stack the lowest address of the stack
+ * @param size the size of the stack
+ * @param start the function to run, it must never return
+ */
+void context_init(Context *context, char *stack, size_t size, void (*start)()) {
+  uintptr_t top = ((uintptr_t) stack + size) & ~(uintptr_t) (STACK_ALIGN - 1);
+  // start is entered by a ret, so its return address slot must be 16 byte aligned,
+  // like the one a call would push. the word above it is a null return address.
+  auto *frame = (uint64_t *) (top - STACK_ALIGN) - (CALLEE_SAVED + 1);
+  frame[0] = DEFAULT_MXCSR | ((uint64_t) DEFAULT_FPU_CW << FPU_CW_SHIFT);
+  for (int i = 1; i <= CALLEE_SAVED; i++) {
+    frame[i] = 0;
+  }
+  frame[CALLEE_SAVED + 1] = (uint64_t) start;
+  frame[CALLEE_SAVED + 2] = 0;
+  context->sp = frame;
+}
@@ -0,0 +1,33 @@
+#ifndef _CONTEXT_H_
+#define _CONTEXT_H_
+
+#include <cstddef>
+
+/***
+ * The saved registers of a thread that is not running.
+ * The callee-saved registers and the x87/SSE control words are pushed on the thread's own
+ * stack, so only the stack pointer is kept here. Switching never enters the kernel: the
+ * signal mask is not saved or restored (the library guards itself with a flag instead).
+ */
+struct Context {
+  void *sp;
+};
+
+/**
+ * prepares a context that starts running start on the given stack.
+ * @param context the context to prepare
+ * @param stack the lowest address of the stack
+ * @param size the size of the stack
+ * @param start the function to run, it must never return
+ */
+void context_init (Context *context, char *stack, size_t size, void (*start) ());
+
+/**
+ * saves the running registers in from and continues with the registers saved in to.
+ * returns when another switch continues with from.
+ * @param from receives the context of the caller
+ * @param to the context to continue with
+ */
+extern "C" void context_switch (Context *from, Context *to);
+
+#endif //_CONTEXT_H_
@@ -0,0 +1,115 @@
+#include "DeadlineHeap.h"
+
+#define NO_INDEX (-1)
+
+/***
+ * returns true if a should wake up before b, the earlier deadline and then the smaller id.
+ */
+bool DeadlineHeap::before(const Thread *a, const Thread *b) {
+  if (a->wake_deadline != b->wake_deadline) {
+    return a->wake_deadline < b->wake_deadline;
+  }
+  return a->get_id() < b->get_id();
+}
+
+/***
+ * puts the thread at heap[index] and updates its deadline_index.
+ */
+void DeadlineHeap::place(Thread *thread, int index) {
+  heap[index] = thread;
+  thread->deadline_index = index;
+}
+
+/***
+ * moves the thread at index up until the heap order holds.
+ */
+void DeadlineHeap::sift_up(int index) {
+  Thread *thread = heap[index];
+  while (index > 0) {
+    int parent = (index - 1) / 2;
+    if (!before(thread, heap[parent])) {
+      break;
+    }
+    place(heap[parent], index);
+    index = parent;
+  }
+  place(thread, index);
+}
+
+/***
+ * moves the thread at index down until the heap order holds.
+ */
+void DeadlineHeap::sift_down(int index) {
+  Thread *thread = heap[index];
+  int size = (int) heap.size();
+  for (;;) {
+    int child = 2 * index + 1;
+    if (child >= size) {
+      break;
+    }
+    if (child + 1 < size && before(heap[child + 1], heap[child])) {
+      child++;
+    }
+    if (!before(heap[child], thread)) {
+      break;
+    }
+    place(heap[child], index);
+    index = child;
+  }
+  place(thread, index);
+}
+
+/**
+ * adds a thread that should wake up at the given time
+ * @param thread the thread, must not be in the heap
+ * @param deadline the CLOCK_MONOTONIC time to wake up at, in nano-seconds
+ */
+void DeadlineHeap::insert(Thread *thread, int64_t deadline) {
+  thread->wake_deadline = deadline;
+  heap.push_back(thread);
+  sift_up((int) heap.size() - 1);
+}
+
+/**
+ * removes a thread from the heap before it expires
+ * @param thread a thread that is in the heap
+ */
+void DeadlineHeap::cancel(Thread *thread) {
+  int index = thread->deadline_index;
+  Thread *last = heap.back();
+  heap.pop_back();
+  thread->deadline_index = NO_INDEX;
+  if (last == thread) {
+    return;
+  }
+  place(last, index);
+  sift_up(index);
+  sift_down(last->deadline_index);
+}
+
+/**
+ * takes out the threads whose deadline passed
+ * @param now the current CLOCK_MONOTONIC time, in nano-seconds
+ * @param expired receives the threads, in the order of their deadlines
+ */
+void DeadlineHeap::expire(int64_t now, ThreadList &expired) {
+  while (!heap.empty() && heap.front()->wake_deadline <= now) {
+    Thread *thread = heap.front();
+    cancel(thread);
+    expired.push_back(thread);
+  }
+}
+
+/**
+ * returns the earliest deadline, the heap must not be empty
+ */
+int64_t DeadlineHeap::next_deadline() const {
+  return heap.front()->wake_deadline;
+}
+
+/**
+ * returns true if no thread is in the heap
+ */
+bool DeadlineHeap::empty() const {
+  return heap.empty();
+}
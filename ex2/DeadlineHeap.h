@@ -0,0 +1,71 @@
+#ifndef _DEADLINE_HEAP_H_
+#define _DEADLINE_HEAP_H_
+
+#include <cstdint>
+#include <vector>
+#include "ThreadList.h"
+
+/***
+ * The threads sleeping until a CLOCK_MONOTONIC time (uthread_sleep_usecs), a binary min
+ * heap on (wake_deadline, id). Every thread keeps its position in deadline_index, so
+ * cancelling a sleep is O(log n).
+ */
+class DeadlineHeap {
+
+ private:
+
+  /***
+   * the sleeping threads.
+   */
+  std::vector<Thread *> heap;
+
+  /***
+   * returns true if a should wake up before b.
+   */
+  static bool before (const Thread *a, const Thread *b);
+
+  /***
+   * puts the thread at heap[index] and updates its deadline_index.
+   */
+  void place (Thread *thread, int index);
+
+  /***
+   * moves the thread at index up / down until the heap order holds.
+   */
+  void sift_up (int index);
+  void sift_down (int index);
+
+ public:
+
+  /**
+   * adds a thread that should wake up at the given time
+   * @param thread the thread, must not be in the heap
+   * @param deadline the CLOCK_MONOTONIC time to wake up at, in nano-seconds
+   */
+  void insert (Thread *thread, int64_t deadline);
+
+  /**
+   * removes a thread from the heap before it expires
+   * @param thread a thread that is in the heap
+   */
+  void cancel (Thread *thread);
+
+  /**
+   * takes out the threads whose deadline passed
+   * @param now the current CLOCK_MONOTONIC time, in nano-seconds
+   * @param expired receives the threads, in the order of their deadlines
+   */
+  void expire (int64_t now, ThreadList &expired);
+
+  /**
+   * returns the earliest deadline, the heap must not be empty
+   */
+  int64_t next_deadline () const;
+
+  /**
+   * returns true if no thread is in the heap
+   */
+  bool empty () const;
+};
+
+#endif //_DEADLINE_HEAP_H_
@@ -0,0 +1,168 @@
+#include "FairPolicy.h"
+#include <new>
+#include "uthreads_ext.h"
+
+#define NO_INDEX (-1)
+#define QUANTUM_SCALE (1 << 20)
+#define DEFAULT_WEIGHT 1024
+
+/***
+ * the weight of every priority, each one 1.25 times the next (as CFS does for nice levels),
+ * UTHREAD_DEFAULT_PRIORITY weighs DEFAULT_WEIGHT.
+ */
+static const int weights[UTHREAD_NUM_PRIORITIES] = {2500, 2000, 1600, 1280, 1024, 819, 655, 524};
+
+/**
+ * a constructor for an empty policy
+ */
+FairPolicy::FairPolicy() : heap(nullptr), size(0), capacity(0), min_vruntime(0) {}
+
+/**
+ * a destructor for the policy
+ */
+FairPolicy::~FairPolicy() {
+  delete[] heap;
+}
+
+/**
+ * makes room for max_threads queued threads
+ * @return false upon failure
+ */
+bool FairPolicy::reserve(int max_threads) {
+  if (max_threads <= capacity) {
+    return true;
+  }
+  auto **grown = new(std::nothrow) Thread *[max_threads];
+  if (grown == nullptr) {
+    return false;
+  }
+  for (int i = 0; i < size; i++) {
+    grown[i] = heap[i];
+  }
+  delete[] heap;
+  heap = grown;
+  capacity = max_threads;
+  return true;
+}
+
+/***
+ * returns true if a should run before b.
+ */
+bool FairPolicy::before(const Thread *a, const Thread *b) {
+  if (a->vruntime != b->vruntime) {
+    return a->vruntime < b->vruntime;
+  }
+  return a->get_id() < b->get_id();
+}
+
+/***
+ * puts the thread at heap[index] and updates its heap_index.
+ */
+void FairPolicy::place(Thread *thread, int index) {
+  heap[index] = thread;
+  thread->heap_index = index;
+}
+
+/***
+ * moves the thread at index up until the heap order holds.
+ */
+void FairPolicy::sift_up(int index) {
+  Thread *thread = heap[index];
+  while (index > 0) {
+    int parent = (index - 1) / 2;
+    if (!before(thread, heap[parent])) {
+      break;
+    }
+    place(heap[parent], index);
+    index = parent;
+  }
+  place(thread, index);
+}
+
+/***
+ * moves the thread at index down until the heap order holds.
+ */
+void FairPolicy::sift_down(int index) {
+  Thread *thread = heap[index];
+  for (;;) {
+    int child = 2 * index + 1;
+    if (child >= size) {
+      break;
+    }
+    if (child + 1 < size && before(heap[child + 1], heap[child])) {
+      child++;
+    }
+    if (!before(heap[child], thread)) {
+      break;
+    }
+    place(heap[child], index);
+    index = child;
+  }
+  place(thread, index);
+}
+
+/**
+ * queues a thread, moving its vruntime up to min_vruntime
+ * @param thread the thread, must not be queued
+ */
+void FairPolicy::enqueue(Thread *thread) {
+  if (thread->vruntime < min_vruntime) {
+    thread->vruntime = min_vruntime;
+  }
+  heap[size++] = thread;
+  sift_up(size - 1);
+}
+
+/**
+ * removes a READY thread before it runs
+ * @param thread a queued thread
+ */
+void FairPolicy::remove(Thread *thread) {
+  int index = thread->heap_index;
+  Thread *last = heap[--size];
+  thread->heap_index = NO_INDEX;
+  if (last == thread) {
+    return;
+  }
+  place(last, index);
+  sift_up(index);
+  sift_down(last->heap_index);
+}
+
+/**
+ * removes the thread with the smallest vruntime
+ * @return the thread, or nullptr if no thread is queued
+ */
+Thread *FairPolicy::pick_next() {
+  if (size == 0) {
+    return nullptr;
+  }
+  Thread *thread = heap[0];
+  remove(thread);
+  if (thread->vruntime > min_vruntime) {
+    min_vruntime = thread->vruntime;
+  }
+  return thread;
+}
+
+/**
+ * returns true if no thread is queued
+ */
+bool FairPolicy::empty() const {
+  return size == 0;
+}
+
+/**
+ * adds a quantum, weighted by the thread's priority, to its vruntime
+ */
+void FairPolicy::charge(Thread *thread) {
+  thread->vruntime += QUANTUM_SCALE / weights[thread->priority];
+}
+
+/**
+ * a thread preempts a thread whose vruntime is ahead of its own by more than a quantum
+ * of the default priority
+ */
+bool FairPolicy::preempts(const Thread *woken, const Thread *running) const {
+  return running->vruntime - woken->vruntime > QUANTUM_SCALE / DEFAULT_WEIGHT;
+}
@@ -0,0 +1,76 @@
+#ifndef _FAIR_POLICY_H_
+#define _FAIR_POLICY_H_
+
+#include <cstdint>
+#include "SchedPolicy.h"
+
+/***
+ * A fair share scheduler in the style of CFS: every quantum a thread starts adds to its
+ * virtual run time, weighted by its priority (a quantum of a more urgent thread adds
+ * less), and the READY thread with the smallest virtual run time runs next. A thread that
+ * becomes READY preempts a RUNNING thread that is ahead of it by more than a quantum.
+ */
+class FairPolicy : public SchedPolicy {
+
+ private:
+
+  /***
+   * the READY threads, a binary min heap on (vruntime, id). every thread keeps its
+   * position in heap_index, so removing from the middle is O(log n). the array is
+   * allocated by reserve ahead, enqueue runs in the timer signal handler and must not
+   * allocate.
+   */
+  Thread **heap;
+  int size;
+  int capacity;
+
+  /***
+   * a lower bound of the vruntime of all the threads, threads that were not READY for a
+   * while are moved up to it so they do not starve the others when they come back.
+   */
+  int64_t min_vruntime;
+
+  /***
+   * returns true if a should run before b.
+   */
+  static bool before (const Thread *a, const Thread *b);
+
+  /***
+   * puts the thread at heap[index] and updates its heap_index.
+   */
+  void place (Thread *thread, int index);
+
+  /***
+   * moves the thread at index up / down until the heap order holds.
+   */
+  void sift_up (int index);
+  void sift_down (int index);
+
+ public:
+
+  /**
+   * a constructor for an empty policy
+   */
+  FairPolicy ();
+
+  /**
+   * a destructor for the policy
+   */
+  ~FairPolicy () override;
+
+  bool reserve (int max_threads) override;
+
+  void enqueue (Thread *thread) override;
+
+  void remove (Thread *thread) override;
+
+  Thread *pick_next () override;
+
+  bool empty () const override;
+
+  void charge (Thread *thread) override;
+
+  bool preempts (const Thread *woken, const Thread *running) const override;
+};
+
+#endif //_FAIR_POLICY_H_
@@ -0,0 +1,32 @@
+#include "FifoPolicy.h"
+
+/**
+ * queues a thread at the end of the queue
+ * @param thread the thread, must not be queued
+ */
+void FifoPolicy::enqueue(Thread *thread) {
+  queue.push_back(thread);
+}
+
+/**
+ * removes a READY thread before it runs
+ * @param thread a thread in the queue
+ */
+void FifoPolicy::remove(Thread *thread) {
+  queue.remove(thread);
+}
+
+/**
+ * removes the first thread of the queue
+ * @return the thread, or nullptr if the queue is empty
+ */
+Thread *FifoPolicy::pick_next() {
+  return queue.pop_front();
+}
+
+/**
+ * returns true if the queue is empty
+ */
+bool FifoPolicy::empty() const {
+  return queue.empty();
+}
@@ -0,0 +1,31 @@
+#ifndef _FIFO_POLICY_H_
+#define _FIFO_POLICY_H_
+
+#include "SchedPolicy.h"
+#include "ThreadList.h"
+
+/***
+ * Round robin: the READY threads run in the order they became READY, and never preempt
+ * the RUNNING thread. The library's default policy.
+ */
+class FifoPolicy : public SchedPolicy {
+
+ private:
+
+  /***
+   * the READY threads.
+   */
+  ThreadList queue;
+
+ public:
+
+  void enqueue (Thread *thread) override;
+
+  void remove (Thread *thread) override;
+
+  Thread *pick_next () override;
+
+  bool empty () const override;
+};
+
+#endif //_FIFO_POLICY_H_
@@ -0,0 +1,54 @@
+#include "PriorityPolicy.h"
+
+/**
+ * a constructor for an empty policy
+ */
+PriorityPolicy::PriorityPolicy() : non_empty(0) {}
+
+/**
+ * queues a thread at the end of the level of its priority
+ * @param thread the thread, must not be queued
+ */
+void PriorityPolicy::enqueue(Thread *thread) {
+  levels[thread->priority].push_back(thread);
+  non_empty |= (uint32_t) 1 << thread->priority;
+}
+
+/**
+ * removes a READY thread before it runs
+ * @param thread a queued thread, its priority must not have changed since it was queued
+ */
+void PriorityPolicy::remove(Thread *thread) {
+  ThreadList &level = levels[thread->priority];
+  level.remove(thread);
+  if (level.empty()) {
+    non_empty &= ~((uint32_t) 1 << thread->priority);
+  }
+}
+
+/**
+ * removes the first thread of the most urgent level that is not empty
+ * @return the thread, or nullptr if no thread is queued
+ */
+Thread *PriorityPolicy::pick_next() {
+  if (non_empty == 0) {
+    return nullptr;
+  }
+  Thread *thread = levels[__builtin_ctz(non_empty)].front();
+  remove(thread);
+  return thread;
+}
+
+/**
+ * returns true if no thread is queued
+ */
+bool PriorityPolicy::empty() const {
+  return non_empty == 0;
+}
+
+/**
+ * a thread preempts a thread of a less urgent priority
+ */
+bool PriorityPolicy::preempts(const Thread *woken, const Thread *running) const {
+  return woken->priority < running->priority;
+}
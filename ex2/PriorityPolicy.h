@@ -0,0 +1,46 @@
+#ifndef _PRIORITY_POLICY_H_
+#define _PRIORITY_POLICY_H_
+
+#include <cstdint>
+#include "SchedPolicy.h"
+#include "ThreadList.h"
+#include "uthreads_ext.h"
+
+/***
+ * Multi-level priority queues: the READY threads of the most urgent priority (the lowest
+ * number) run first, round robin among themselves, and a thread that becomes READY
+ * preempts a RUNNING thread of a less urgent priority.
+ */
+class PriorityPolicy : public SchedPolicy {
+
+ private:
+
+  /***
+   * the READY threads of every priority.
+   */
+  ThreadList levels[UTHREAD_NUM_PRIORITIES];
+
+  /***
+   * bit p is set if levels[p] is not empty.
+   */
+  uint32_t non_empty;
+
+ public:
+
+  /**
+   * a constructor for an empty policy
+   */
+  PriorityPolicy ();
+
+  void enqueue (Thread *thread) override;
+
+  void remove (Thread *thread) override;
+
+  Thread *pick_next () override;
+
+  bool empty () const override;
+
+  bool preempts (const Thread *woken, const Thread *running) const override;
+};
+
+#endif //_PRIORITY_POLICY_H_
@@ -0,0 +1,161 @@
+#include "Reactor.h"
+#include <cerrno>
+#include <new>
+#include <unistd.h>
+
+#define READ_EVENTS (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)
+#define WRITE_EVENTS (EPOLLOUT | EPOLLERR | EPOLLHUP)
+#define NO_FD (-1)
+
+/**
+ * a constructor for a reactor without an epoll instance yet
+ */
+Reactor::Reactor() : epoll_fd(NO_FD), armed_count(0) {}
+
+/**
+ * a destructor for the reactor, closes the epoll instance
+ */
+Reactor::~Reactor() {
+  for (FdWaiters *waiters : fds) {
+    delete waiters;
+  }
+  if (epoll_fd != NO_FD) {
+    close(epoll_fd);
+  }
+}
+
+/**
+ * creates the epoll instance
+ * @return true upon success, false upon failure
+ */
+bool Reactor::init() {
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  return epoll_fd != NO_FD;
+}
+
+/**
+ * arms an fd for the events its waiters need, or disarms it if there are none.
+ * the fd stays registered when disarmed, a closed fd leaves the epoll instance by itself,
+ * so the registration is retried the other way when it turns out to be stale.
+ * @return true upon success, false upon failure (errno set by epoll_ctl)
+ */
+bool Reactor::arm(int fd, FdWaiters *waiters) {
+  uint32_t events = (waiters->readers.empty() ? 0 : EPOLLIN | EPOLLRDHUP)
+                    | (waiters->writers.empty() ? 0 : EPOLLOUT);
+  if (events == 0) {
+    if (waiters->armed_events != 0) {
+      armed_count--;
+    }
+    waiters->armed_events = 0;
+    return true;
+  }
+  if (events == waiters->armed_events) {
+    return true;
+  }
+  epoll_event event{};
+  event.events = events | EPOLLONESHOT;
+  event.data.fd = fd;
+  int op = waiters->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+  if (epoll_ctl(epoll_fd, op, fd, &event) != 0) {
+    if (errno != ENOENT && errno != EEXIST) {
+      return false;
+    }
+    op = op == EPOLL_CTL_MOD ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    if (epoll_ctl(epoll_fd, op, fd, &event) != 0) {
+      return false;
+    }
+  }
+  waiters->registered = true;
+  if (waiters->armed_events == 0) {
+    armed_count++;
+  }
+  waiters->armed_events = events;
+  return true;
+}
+
+/**
+ * queues a thread to wait until an fd is readable or writable
+ * @param thread the thread, must not be in any list
+ * @param fd the fd
+ * @param write wait for the fd to be writable rather than readable
+ * @return true upon success, false upon failure (errno is set, the thread is not queued)
+ */
+bool Reactor::wait(Thread *thread, int fd, bool write) {
+  if (fd < 0) {
+    errno = EBADF;
+    return false;
+  }
+  if ((size_t) fd >= fds.size()) {
+    fds.resize(fd + 1, nullptr);
+  }
+  if (fds[fd] == nullptr) {
+    fds[fd] = new(std::nothrow) FdWaiters();
+    if (fds[fd] == nullptr) {
+      errno = ENOMEM;
+      return false;
+    }
+  }
+  FdWaiters *waiters = fds[fd];
+  ThreadList *list = write ? &waiters->writers : &waiters->readers;
+  list->push_back(thread);
+  thread->wait_queue = list;
+  if (!arm(fd, waiters)) {
+    int error = errno;
+    list->remove(thread);
+    thread->wait_queue = nullptr;
+    arm(fd, waiters);
+    errno = error;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * reads the ready events of the epoll instance
+ * @param events receives the events
+ * @param max_events the size of events
+ * @param timeout_ms as in epoll_wait, 0 to poll and -1 to block
+ * @param sigmask the signal mask to wait with, as in epoll_pwait, or nullptr
+ * @return the number of events read, 0 if interrupted
+ */
+int Reactor::fetch(epoll_event *events, int max_events, int timeout_ms, const sigset_t *sigmask) {
+  int count = epoll_pwait(epoll_fd, events, max_events, timeout_ms, sigmask);
+  return count < 0 ? 0 : count;
+}
+
+/**
+ * takes the threads the events are ready for out of their lists: the first reader and
+ * the first writer. the fd was disarmed by EPOLLONESHOT and is armed again for the rest.
+ * @param events events read by fetch
+ * @param count the number of events
+ * @param ready receives the threads
+ */
+void Reactor::dispatch(const epoll_event *events, int count, ThreadList &ready) {
+  for (int i = 0; i < count; i++) {
+    FdWaiters *waiters = fds[events[i].data.fd];
+    if (events[i].events & READ_EVENTS && !waiters->readers.empty()) {
+      ready.push_back(waiters->readers.pop_front());
+    }
+    if (events[i].events & WRITE_EVENTS && !waiters->writers.empty()) {
+      ready.push_back(waiters->writers.pop_front());
+    }
+    armed_count--;
+    waiters->armed_events = 0;
+    if (!arm(events[i].data.fd, waiters)) {
+      // the fd was closed under its waiters, they retry and get the error themselves
+      while (!waiters->readers.empty()) {
+        ready.push_back(waiters->readers.pop_front());
+      }
+      while (!waiters->writers.empty()) {
+        ready.push_back(waiters->writers.pop_front());
+      }
+    }
+  }
+}
+
+/**
+ * returns true if any thread may be waiting for an fd
+ */
+bool Reactor::armed() const {
+  return __atomic_load_n(&armed_count, __ATOMIC_RELAXED) > 0;
+}
@@ -0,0 +1,104 @@
+#ifndef _REACTOR_H_
+#define _REACTOR_H_
+
+#include <cstdint>
+#include <vector>
+#include <sys/epoll.h>
+#include "ThreadList.h"
+
+/***
+ * the threads waiting on one file descriptor, and the events it is armed for.
+ */
+struct FdWaiters {
+  ThreadList readers, writers;
+  uint32_t armed_events;
+  bool registered;
+};
+
+/***
+ * An epoll reactor for the threads waiting for file descriptors (IO_WAIT).
+ * Every fd is registered with EPOLLONESHOT for the directions threads wait on, so a
+ * readiness event is reported once, wakes one reader and one writer, and the fd is armed
+ * again only if more threads wait on it. The waiters of an fd are ThreadLists, a thread
+ * waiting on one of them is its wait_queue, so terminating it removes it.
+ * Fetching events touches no data and may run on several workers at once without a lock,
+ * everything else runs under the lock of the reactor, and armed may be read without it.
+ */
+class Reactor {
+
+ private:
+
+  /***
+   * the epoll instance, -1 before init.
+   */
+  int epoll_fd;
+
+  /***
+   * the waiters of every fd, indexed by the fd. allocated on the first wait on the fd and
+   * never moved, the threads point at their lists.
+   */
+  std::vector<FdWaiters *> fds;
+
+  /***
+   * number of fds armed for some event.
+   */
+  int armed_count;
+
+  /***
+   * arms an fd for the events its waiters need, or disarms it if there are none.
+   * @return true upon success, false upon failure (errno set by epoll_ctl)
+   */
+  bool arm (int fd, FdWaiters *waiters);
+
+ public:
+
+  /**
+   * a constructor for a reactor without an epoll instance yet
+   */
+  Reactor ();
+
+  /**
+   * a destructor for the reactor, closes the epoll instance
+   */
+  ~Reactor ();
+
+  /**
+   * creates the epoll instance
+   * @return true upon success, false upon failure
+   */
+  bool init ();
+
+  /**
+   * queues a thread to wait until an fd is readable or writable
+   * @param thread the thread, must not be in any list
+   * @param fd the fd
+   * @param write wait for the fd to be writable rather than readable
+   * @return true upon success, false upon failure (errno is set, the thread is not queued)
+   */
+  bool wait (Thread *thread, int fd, bool write);
+
+  /**
+   * reads the ready events of the epoll instance
+   * @param events receives the events
+   * @param max_events the size of events
+   * @param timeout_ms as in epoll_wait, 0 to poll and -1 to block
+   * @param sigmask the signal mask to wait with, as in epoll_pwait, or nullptr
+   * @return the number of events read, 0 if interrupted
+   */
+  int fetch (epoll_event *events, int max_events, int timeout_ms, const sigset_t *sigmask);
+
+  /**
+   * takes the threads the events are ready for out of their lists
+   * @param events events read by fetch
+   * @param count the number of events
+   * @param ready receives the threads
+   */
+  void dispatch (const epoll_event *events, int count, ThreadList &ready);
+
+  /**
+   * returns true if any thread may be waiting for an fd
+   */
+  bool armed () const;
+};
+
+#endif //_REACTOR_H_
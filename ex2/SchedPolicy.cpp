@@ -0,0 +1,59 @@
+#include "SchedPolicy.h"
+#include <new>
+#include "uthreads_ext.h"
+#include "FifoPolicy.h"
+#include "PriorityPolicy.h"
+#include "FairPolicy.h"
+
+/**
+ * makes room for max_threads queued threads, the list policies need none
+ * @param max_threads the maximal number of threads
+ * @return false upon failure
+ */
+bool SchedPolicy::reserve(int max_threads) {
+  return true;
+}
+
+/**
+ * called when a thread picked from this policy starts a quantum
+ * @param thread the thread
+ */
+void SchedPolicy::charge(Thread *thread) {}
+
+/**
+ * returns true if a thread that became READY should run before the end of the
+ * quantum of the RUNNING thread
+ * @param woken the READY thread
+ * @param running the RUNNING thread
+ */
+bool SchedPolicy::preempts(const Thread *woken, const Thread *running) const {
+  return false;
+}
+
+/**
+ * creates a policy object
+ * @param policy one of the UTHREAD_POLICY_* values
+ * @param max_threads the maximal number of threads to reserve room for
+ * @return the policy, or nullptr if policy is not a known policy or memory ran out
+ */
+SchedPolicy *SchedPolicy::create(int policy, int max_threads) {
+  SchedPolicy *created;
+  switch (policy) {
+    case UTHREAD_POLICY_FIFO:
+      created = new(std::nothrow) FifoPolicy();
+      break;
+    case UTHREAD_POLICY_PRIORITY:
+      created = new(std::nothrow) PriorityPolicy();
+      break;
+    case UTHREAD_POLICY_FAIR:
+      created = new(std::nothrow) FairPolicy();
+      break;
+    default:
+      return nullptr;
+  }
+  if (created != nullptr && !created->reserve(max_threads)) {
+    delete created;
+    return nullptr;
+  }
+  return created;
+}
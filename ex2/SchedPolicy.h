@@ -0,0 +1,74 @@
+#ifndef _SCHED_POLICY_H_
+#define _SCHED_POLICY_H_
+
+#include "Thread.h"
+
+/***
+ * The order READY threads run in. Every worker keeps its READY threads in a policy
+ * object of the policy the library was set to, which decides which thread runs next,
+ * and whether a thread that became READY should preempt the RUNNING thread.
+ */
+class SchedPolicy {
+
+ public:
+
+  /**
+   * a destructor for the policy
+   */
+  virtual ~SchedPolicy () = default;
+
+  /**
+   * queues a thread that became READY
+   * @param thread the thread, must not be queued
+   */
+  virtual void enqueue (Thread *thread) = 0;
+
+  /**
+   * removes a READY thread before it runs (it was blocked or terminated)
+   * @param thread a thread queued in this policy
+   */
+  virtual void remove (Thread *thread) = 0;
+
+  /**
+   * removes the thread that should run next
+   * @return the thread, or nullptr if no thread is queued
+   */
+  virtual Thread *pick_next () = 0;
+
+  /**
+   * returns true if no thread is queued
+   */
+  virtual bool empty () const = 0;
+
+  /**
+   * makes room for max_threads queued threads, so that enqueue does not allocate (it runs
+   * in the timer signal handler)
+   * @param max_threads the maximal number of threads
+   * @return false upon failure
+   */
+  virtual bool reserve (int max_threads);
+
+  /**
+   * called when a thread picked from this policy starts a quantum
+   * @param thread the thread
+   */
+  virtual void charge (Thread *thread);
+
+  /**
+   * returns true if a thread that became READY should run before the end of the
+   * quantum of the RUNNING thread
+   * @param woken the READY thread
+   * @param running the RUNNING thread
+   */
+  virtual bool preempts (const Thread *woken, const Thread *running) const;
+
+  /**
+   * creates a policy object
+   * @param policy one of the UTHREAD_POLICY_* values
+   * @param max_threads the maximal number of threads to reserve room for
+   * @return the policy, or nullptr if policy is not a known policy or memory ran out
+   */
+  static SchedPolicy *create (int policy, int max_threads);
+};
+
+#endif //_SCHED_POLICY_H_
@@ -0,0 +1,73 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include "SpinLock.h"
+#include "Thread.h"
+
+/*
+ * The parts of the scheduler (uthreads.cpp) the other files of the library use.
+ */
+
+//---------------thread states-----------------------------------------
+#define READY  0
+#define RUNNING 1
+#define BLOCKED 2
+#define SLEEPING 3
+#define WAITING 4
+#define SUICIDE 5
+#define IO_WAIT 6
+#define ZOMBIE 7
+
+/***
+ * enters a critical section, the timer signal will not switch threads until it is left.
+ * the calling thread stays on its worker until it leaves, unless it switches itself out.
+ * the data shared between the workers is guarded by the spin locks taken inside it.
+ */
+void enter_critical ();
+
+/***
+ * leaves a critical section, switching threads if the quantum ended inside it
+ */
+void leave_critical ();
+
+/***
+ * returns the RUNNING thread of the calling worker, inside a critical section.
+ */
+Thread *running_thread ();
+
+/***
+ * take and release a spin lock, inside a critical section. they do nothing while one
+ * worker runs the threads. a lock must not be held while the thread switches out.
+ */
+void acquire (SpinLock &lock);
+void release (SpinLock &lock);
+
+/***
+ * puts the running thread to wait (WAITING) on a queue, whose lock the caller holds, until
+ * another thread wakes it up: queues it, releases the lock and switches to the next thread,
+ * inside a critical section. returns when the thread runs again.
+ * @param arg what the thread waits with, read by the thread that wakes it up
+ */
+void wait_on (ThreadList *queue, SpinLock *list_lock, void *arg);
+
+/***
+ * ends the sleep or wait of a thread, that was already taken out of the wheel or the
+ * wait queue under its lock, which is still held: turns it to BLOCKED if it was blocked
+ * meanwhile, and to READY otherwise.
+ */
+void wake_thread (Thread *thread);
+
+/***
+ * return and set errno of the calling kernel thread. unlike errno itself they may be used
+ * after a call that switches threads, when the thread may run on another worker.
+ */
+int get_errno ();
+void set_errno (int error);
+
+/***
+ * puts the running thread to wait (IO_WAIT) until an fd is readable or writable.
+ * returns 0 when the fd may be ready, and -1 with errno set if it cant be waited on.
+ */
+int wait_fd (int fd, bool write);
+
+#endif //_SCHEDULER_H_
@@ -0,0 +1,45 @@
+#include "SpinLock.h"
+#include <sched.h>
+
+#define FREE 0
+#define HELD 1
+#define LOCK_SPINS 1000
+
+/**
+ * a constructor for a free lock
+ */
+SpinLock::SpinLock() : held(FREE) {}
+
+/**
+ * takes the lock, waiting until it is free
+ */
+void SpinLock::lock() {
+  for (int spins = 0; !try_lock(); spins++) {
+    // wait on plain reads, so the cache line of the lock is not written while it is held
+    while (__atomic_load_n(&held, __ATOMIC_RELAXED) == HELD) {
+      if (spins < LOCK_SPINS) {
+        __builtin_ia32_pause();
+        spins++;
+      } else {
+        // the holder may be off the cpu (more workers than cpus), let it run
+        sched_yield();
+      }
+    }
+  }
+}
+
+/**
+ * takes the lock if it is free, without waiting
+ * @return true if the lock was taken
+ */
+bool SpinLock::try_lock() {
+  return __atomic_load_n(&held, __ATOMIC_RELAXED) == FREE
+         && __atomic_exchange_n(&held, HELD, __ATOMIC_ACQUIRE) == FREE;
+}
+
+/**
+ * releases the lock, which the caller holds
+ */
+void SpinLock::unlock() {
+  __atomic_store_n(&held, FREE, __ATOMIC_RELEASE);
+}
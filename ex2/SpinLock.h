@@ -0,0 +1,44 @@
+#ifndef _SPIN_LOCK_H_
+#define _SPIN_LOCK_H_
+
+/***
+ * A test and test-and-set spin lock, guarding one of the library's data structures while
+ * more than one worker runs the threads.
+ * The critical sections under it are short and never switch threads, so a waiter spins
+ * on reads of the lock, and yields the cpu after a while since the holder may be off the
+ * cpu when there are more workers than cpus.
+ */
+class SpinLock {
+
+ private:
+
+  /***
+   * 1 while the lock is held, 0 when it is free.
+   */
+  int held;
+
+ public:
+
+  /**
+   * a constructor for a free lock
+   */
+  SpinLock ();
+
+  /**
+   * takes the lock, waiting until it is free
+   */
+  void lock ();
+
+  /**
+   * takes the lock if it is free, without waiting
+   * @return true if the lock was taken
+   */
+  bool try_lock ();
+
+  /**
+   * releases the lock, which the caller holds
+   */
+  void unlock ();
+};
+
+#endif //_SPIN_LOCK_H_
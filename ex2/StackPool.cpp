@@ -0,0 +1,169 @@
+#include "StackPool.h"
+#include <algorithm>
+#include <csignal>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define RESIDENT 1
+#define SIGNAL_FRAMES 2
+#define SLAB_SIZE (4ul << 20)
+#define MIN_SLAB_STACKS 1
+
+// a guard region that does not split the mapping (Linux 6.13), missing in older headers
+#ifndef MADV_GUARD_INSTALL
+#define MADV_GUARD_INSTALL 102
+#endif
+
+/**
+ * a constructor for the pool
+ * @param size the usable size of every stack, rounded up to whole pages
+ * @param max_cached the maximal number of released stacks that keep their pages for reuse
+ * @param lazy map the slabs with MAP_NORESERVE
+ * @param trim drop the touched pages of a stack when it is reused
+ */
+StackPool::StackPool(size_t size, int max_cached, bool lazy, bool trim) {
+  guard_size = sysconf(_SC_PAGESIZE);
+  stack_size = (size + guard_size - 1) / guard_size * guard_size;
+  // glibc may turn MINSIGSTKSZ into SIGSTKSZ, several frames' worth, so the kernel's own
+  // minimum for the cpu's register state is used when it is known
+  long frame_size = MINSIGSTKSZ;
+#ifdef _SC_MINSIGSTKSZ
+  if (sysconf(_SC_MINSIGSTKSZ) > 0) {
+    frame_size = sysconf(_SC_MINSIGSTKSZ);
+  }
+#endif
+  signal_reserve = (SIGNAL_FRAMES * frame_size + guard_size - 1) / guard_size * guard_size;
+  slot_size = guard_size + signal_reserve + stack_size;
+  slab_stacks = std::max(MIN_SLAB_STACKS, (int) (SLAB_SIZE / slot_size));
+  lazy_commit = lazy;
+  trim_reused = trim;
+  free_stacks = nullptr;
+  free_count = 0;
+  max_free = max_cached;
+  fresh_slot = nullptr;
+  fresh_count = 0;
+  in_use = 0;
+}
+
+/**
+ * a destructor for the pool, unmaps the slabs unless a stack is still in use (a thread
+ * may end the process running on one)
+ */
+StackPool::~StackPool() {
+  if (in_use > 0) {
+    return;
+  }
+  for (char *slab : slabs) {
+    munmap(slab, slot_size * slab_stacks);
+  }
+}
+
+/**
+ * returns the address of the top word of a stack.
+ */
+char **StackPool::top_word(char *stack) const {
+  return (char **) (stack + stack_size - sizeof(char *));
+}
+
+/**
+ * returns the start of the slot of a stack.
+ */
+char *StackPool::slot_of(char *stack) const {
+  return stack - signal_reserve - guard_size;
+}
+
+/**
+ * drops the pages of a free stack, all but its top page, which links it in the free list.
+ */
+void StackPool::trim(char *stack) const {
+  madvise(stack - signal_reserve, signal_reserve + stack_size - guard_size, MADV_DONTNEED);
+}
+
+/**
+ * makes the guard page at the start of a slot fault on every access. A guard region leaves
+ * the slab one mapping; a kernel without them gets an mprotect'd page, which is a mapping of
+ * its own, and once vm.max_map_count is reached the stack goes without a guard rather than
+ * failing the spawn.
+ */
+void StackPool::protect_guard(char *slot) const {
+  if (madvise(slot, guard_size, MADV_GUARD_INSTALL) != 0) {
+    mprotect(slot, guard_size, PROT_NONE);
+  }
+}
+
+/**
+ * returns a stack, reusing a released one if there is one
+ * @return the lowest usable address of the stack, or nullptr upon failure
+ */
+char *StackPool::allocate() {
+  if (free_stacks != nullptr) {
+    char *stack = free_stacks;
+    free_stacks = *top_word(stack);
+    free_count--;
+    in_use++;
+    // nothing runs on a stack in the pool, all but its top page can be dropped
+    if (trim_reused) {
+      trim(stack);
+    }
+    return stack;
+  }
+  if (fresh_count == 0) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK | (lazy_commit ? MAP_NORESERVE : 0);
+    void *slab = mmap(nullptr, slot_size * slab_stacks, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (slab == MAP_FAILED) {
+      return nullptr;
+    }
+    slabs.push_back((char *) slab);
+    fresh_slot = (char *) slab;
+    fresh_count = slab_stacks;
+  }
+  char *slot = fresh_slot;
+  fresh_slot += slot_size;
+  fresh_count--;
+  in_use++;
+  protect_guard(slot);
+  return slot + guard_size + signal_reserve;
+}
+
+/**
+ * gives a stack back to the pool
+ * @param stack a stack returned by allocate
+ */
+void StackPool::release(char *stack) {
+  *top_word(stack) = free_stacks;
+  free_stacks = stack;
+  free_count++;
+  in_use--;
+  // the released stack may be the one running (a thread terminating itself), so a full
+  // pool drops the pages of the stack released before it instead
+  if (free_count > max_free && free_count > 1) {
+    trim(*top_word(stack));
+  }
+}
+
+/**
+ * returns the usable size of every stack
+ */
+size_t StackPool::size() const {
+  return stack_size;
+}
+
+/**
+ * returns the depth of a stack that was touched so far: the distance from its top to its
+ * lowest page that is resident in memory
+ * @param stack a stack returned by allocate
+ */
+size_t StackPool::high_water(char *stack) const {
+  size_t depth = signal_reserve + stack_size;
+  size_t pages = depth / guard_size;
+  std::vector<unsigned char> resident(pages);
+  if (mincore(stack - signal_reserve, depth, resident.data()) != 0) {
+    return 0;
+  }
+  for (size_t page = 0; page < pages; page++) {
+    if (resident[page] & RESIDENT) {
+      return depth - page * guard_size;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,140 @@
+#ifndef _STACK_POOL_H_
+#define _STACK_POOL_H_
+
+#include <cstddef>
+#include <vector>
+
+/***
+ * An allocator of thread stacks of one size.
+ * The stacks are carved out of slabs, large mappings of many stacks each, so the number of
+ * mappings the kernel counts against vm.max_map_count grows with the slabs rather than with
+ * the threads. Every stack has a guard page below it, so a stack overflow faults
+ * immediately instead of silently running into the stack below. Between the guard and the
+ * stack there is room for two nested signal frames: the timer signal and the scheduler run
+ * on the stack of the thread they interrupt, and with AVX-512 state a frame takes most of
+ * a 4KB stack.
+ * Released stacks are kept on a free list (linked through the top word of each stack)
+ * and handed out again, so spawn/terminate churn does not reach the kernel. The pages of
+ * a stack are committed when they are first touched, and a pool of large stacks gives the
+ * touched pages of a reused stack back to the kernel, so a deep thread does not leave its
+ * memory to every thread that reuses its stack.
+ */
+class StackPool {
+
+ private:
+
+  /***
+   * the usable size of a stack and the size of its slot in a slab (with the guard page and
+   * the signal frames' room).
+   */
+  size_t stack_size, slot_size;
+
+  /***
+   * the size of the guard page, and of the room for signal frames below the usable stack.
+   */
+  size_t guard_size, signal_reserve;
+
+  /***
+   * the number of stacks in a slab.
+   */
+  int slab_stacks;
+
+  /***
+   * map slabs with MAP_NORESERVE, so no swap is reserved for them up front.
+   */
+  bool lazy_commit;
+
+  /***
+   * drop the touched pages of a stack when it is reused.
+   */
+  bool trim_reused;
+
+  /***
+   * the free stacks, each one storing the next one in its top word.
+   */
+  char *free_stacks;
+
+  /***
+   * number of free stacks, and the maximal number that keep their pages.
+   */
+  int free_count, max_free;
+
+  /***
+   * the next slot of the last slab that was never handed out, and the number of such slots.
+   */
+  char *fresh_slot;
+  int fresh_count;
+
+  /***
+   * number of stacks handed out and not released.
+   */
+  int in_use;
+
+  /***
+   * the slabs, unmapped with the pool.
+   */
+  std::vector<char *> slabs;
+
+  /***
+   * returns the address of the top word of a stack.
+   */
+  char **top_word (char *stack) const;
+
+  /***
+   * returns the start of the slot of a stack.
+   */
+  char *slot_of (char *stack) const;
+
+  /***
+   * drops the pages of a free stack, all but its top page, which links it in the free list.
+   */
+  void trim (char *stack) const;
+
+  /***
+   * makes the guard page at the start of a slot fault on every access.
+   */
+  void protect_guard (char *slot) const;
+
+ public:
+
+  /**
+   * a constructor for the pool
+   * @param size the usable size of every stack, rounded up to whole pages
+   * @param max_cached the maximal number of released stacks that keep their pages for reuse
+   * @param lazy map the slabs with MAP_NORESERVE
+   * @param trim drop the touched pages of a stack when it is reused
+   */
+  StackPool (size_t size, int max_cached, bool lazy, bool trim);
+
+  /**
+   * a destructor for the pool, unmaps the slabs unless a stack is still in use (a thread
+   * may end the process running on one)
+   */
+  ~StackPool ();
+
+  /**
+   * returns a stack, reusing a released one if there is one
+   * @return the lowest usable address of the stack, or nullptr upon failure
+   */
+  char *allocate ();
+
+  /**
+   * gives a stack back to the pool
+   * @param stack a stack returned by allocate
+   */
+  void release (char *stack);
+
+  /**
+   * returns the usable size of every stack
+   */
+  size_t size () const;
+
+  /**
+   * returns the depth of a stack that was touched so far: the distance from its top to its
+   * lowest page that is resident in memory, which may be in the signal frames' room
+   * @param stack a stack returned by allocate
+   */
+  size_t high_water (char *stack) const;
+};
+
+#endif //_STACK_POOL_H_
@@ -1,51 +1,61 @@
 #include "Thread.h"
-#include <iostream>
-#include <signal.h>
+#include "uthreads_ext.h"
 
 
-#define BAD_ALLOC "system error: bad memory allocation"
 #define DEFAULT_RUN_TIME 0
 #define MAIN_THREAD_ID 0
-#define JB_SP 6
-#define JB_PC 7
+#define DEFAULT_QUANTUM 0
+#define NO_INDEX (-1)
 using namespace std;
 
-//-------------------black box-------------------------------------
-address_t translate_address(address_t addr) {
-  address_t ret;
-  asm volatile("xor    %%fs:0x30,%0\n"
-               "rol    $0x11,%0\n"
-  : "=g" (ret)
-  : "0" (addr));
-  return ret;
-}
-//-----------------------------------------------------------------
-
-
 /**
- * a constructor for the thread
+ * a constructor for the thread, which has no stack if none can be allocated (see has_stack)
  * @param t_id the thread's unique id
- * @param stack_size the size of the stack
+ * @param pool the pool the thread's stack is taken from
  * @param thread_func the function that the thread is doing
+ * @param start the function the thread's context starts at, it runs thread_func
  * @param t_state the thread's state
  */
-Thread::Thread(int t_id, int stack_size, thread_entry_point thread_func, int t_state) {
-  stack = new(nothrow) char[stack_size];
-  if (stack == nullptr) {
-    cerr << BAD_ALLOC << endl;
-    exit(EXIT_FAILURE);
-  }
+Thread::Thread(int t_id, StackPool *pool, thread_entry_point thread_func, thread_entry_point start,
+               int t_state) {
+  stack = nullptr;
+  stack_pool = pool;
   id = t_id;
   state = t_state;
   total_run_time = DEFAULT_RUN_TIME;
-  if (t_id != MAIN_THREAD_ID) {
-    pc = (address_t) thread_func;
-    sp = (address_t) stack + stack_size - sizeof(address_t);
+  prev = next = nullptr;
+  wake_time = DEFAULT_RUN_TIME;
+  timer_slot = nullptr;
+  wake_deadline = DEFAULT_RUN_TIME;
+  deadline_index = NO_INDEX;
+  blocked = false;
+  wait_queue = nullptr;
+  wait_arg = nullptr;
+  wait_lock = nullptr;
+  on_cpu = false;
+  worker = 0;
+  priority = UTHREAD_DEFAULT_PRIORITY;
+  quantum_usecs = DEFAULT_QUANTUM;
+  vruntime = DEFAULT_RUN_TIME;
+  heap_index = NO_INDEX;
+  stats = uthread_stats_t();
+  for (void *&value : specific) {
+    value = nullptr;
+  }
+  ready_since = running_since = DEFAULT_RUN_TIME;
+  arg_entry = nullptr;
+  arg = result = nullptr;
+  detached = true;
+  entry = thread_func;
+  context.sp = nullptr;
+  if (t_id == MAIN_THREAD_ID) {
+    return;
+  }
+  stack = stack_pool->allocate();
+  if (stack == nullptr) {
+    return;
   }
-  sigsetjmp(env, 1);
-  env->__jmpbuf[JB_SP] = translate_address(sp);
-  env->__jmpbuf[JB_PC] = translate_address(pc);
-  sigemptyset(&env->__saved_mask);
+  context_init(&context, stack, stack_pool->size(), start);
 }
 
 /**
@@ -53,15 +63,17 @@ Thread::Thread(int t_id, int stack_size, thread_entry_point thread_func, int t_s
  * @return the state of the thread
  */
 int Thread::get_state() const {
-  return state;
+  return __atomic_load_n(&state, __ATOMIC_ACQUIRE);
 }
 
 /**
- * changes the state of the thread
+ * changes the state of the thread. a worker that reads the new state sees the changes made
+ * before it, a worker that takes a READY thread out of a run queue turns it to RUNNING
+ * without the thread's lock.
  * @param t_state the state of the thread
  */
 void Thread::change_state(int t_state) {
-  state = t_state;
+  __atomic_store_n(&state, t_state, __ATOMIC_RELEASE);
 }
 
 /**
@@ -76,7 +88,7 @@ int Thread::get_run_time() const {
  * a destructor for the class
  */
 Thread::~Thread() {
-  delete[] stack;
+  release_stack();
 }
 
 /**
@@ -93,3 +105,43 @@ int Thread::get_id() const {
 void Thread::increase_run_time() {
   total_run_time++;
 }
+
+/**
+ * returns the function the thread runs
+ * @return the function the thread runs
+ */
+thread_entry_point Thread::get_entry() const {
+  return entry;
+}
+
+/**
+ * gives the thread's stack back to the pool, once the thread does not run anymore
+ */
+void Thread::release_stack() {
+  if (stack != nullptr) {
+    stack_pool->release(stack);
+    stack = nullptr;
+  }
+}
+
+/**
+ * returns whether the thread has a stack of its own, false for the main thread and for a
+ * thread whose stack could not be allocated
+ */
+bool Thread::has_stack() const {
+  return stack != nullptr;
+}
+
+/**
+ * returns the usable size of the thread's stack, 0 for the main thread
+ */
+size_t Thread::stack_size() const {
+  return stack == nullptr ? 0 : stack_pool->size();
+}
+
+/**
+ * returns the depth of the thread's stack that was touched so far, 0 for the main thread
+ */
+size_t Thread::stack_high_water() const {
+  return stack == nullptr ? 0 : stack_pool->high_water(stack);
+}
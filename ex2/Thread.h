@@ -1,16 +1,27 @@
 #ifndef _THREAD_H_
 #define _THREAD_H_
 
-#include <csetjmp>
+#include <cstddef>
+#include <cstdint>
+#include "Context.h"
+#include "SpinLock.h"
+#include "StackPool.h"
+#include "uthreads_ext.h"
 
 
-typedef unsigned long address_t;
+class ThreadList;
+
 typedef void (*thread_entry_point) ();
 
+#define CACHE_LINE 64
+
 /***
  * A class represents a thread.
+ * The fields the scheduler uses on every switch come first and fill the first cache line
+ * of the thread (the threads live cache line aligned in the segments of the ThreadTable),
+ * the fields used only to sleep, wait, join or trace follow them.
  */
-class Thread {
+class alignas(CACHE_LINE) Thread {
 
  private:
 
@@ -20,40 +31,133 @@ class Thread {
   int id;
 
   /***
-   * A pointer to the stack memory of the thread.
+   * Threads' state - can be READY, RUNNING, BLOCKED, SLEEPING, WAITING, IO_WAIT, SUICIDE or ZOMBIE.
    */
-  char *stack;
+  int state;
 
   /***
-   * Threads' state - can be READY, RUNNING, BLOCKED, SLEEPING or BLOCKED AND SLEEPING.
+   * quantums number the thread is running so far.
    */
-  int state;
+  int total_run_time;
+
+ public:
 
   /***
-   * pc's and sp's thread addresses.
+   * guards the state of the thread and the lists it is in, with more than one worker.
+   * the lock of a list a thread waits in is taken before the thread's, and the lock of a
+   * run queue after it (see uthreads.cpp).
    */
-  address_t pc, sp;
+  SpinLock lock;
 
   /***
-   * quantums number the thread is running so far.
+   * set while a worker runs the thread, until the worker that switches it out saved its
+   * registers. a worker that takes the thread from a run queue waits for it to be cleared.
    */
-  int total_run_time;
+  bool on_cpu;
 
- public:
-  
-/***
- * The environment if the thread
- */
-  sigjmp_buf env;
+  /***
+   * the saved registers of the thread while it is not running.
+   */
+  Context context;
+
+  /***
+   * links of the ThreadList the thread is queued in, nullptr when it is in none.
+   */
+  Thread *prev, *next;
+
+  /***
+   * the weighted run time of the thread and its position in the heap of the fair policy.
+   */
+  int64_t vruntime;
+  int heap_index;
+
+  /***
+   * the index of the worker whose run list holds the thread while it is READY, or that
+   * runs it while it is RUNNING.
+   */
+  int worker;
+
+  /***
+   * the scheduling priority of the thread, 0 is the most urgent.
+   */
+  int priority;
+
+  /***
+   * the quantum length of the thread in micro-seconds, 0 for the library's quantum.
+   */
+  int quantum_usecs;
+
+  //---------------the fields below are not used by every switch---------------
+
+  /***
+   * set while the thread is blocked by uthread_block. a SLEEPING, WAITING or IO_WAIT thread
+   * that is blocked turns to BLOCKED instead of READY when it wakes up.
+   */
+  bool blocked;
+
+  /***
+   * the wait queue of a WAITING or IO_WAIT thread (nullptr when it is not waiting), and the data it
+   * passes to the thread that wakes it up.
+   */
+  ThreadList *wait_queue;
+  void *wait_arg;
+
+  /***
+   * the lock of the wait queue or the timers a WAITING, IO_WAIT or SLEEPING thread waits in,
+   * nullptr when it does not wait.
+   */
+  SpinLock *wait_lock;
+
+  /***
+   * the quantum a SLEEPING thread wakes up at, and the TimerWheel slot it waits in
+   * (nullptr when it is not sleeping).
+   */
+  int wake_time;
+  ThreadList *timer_slot;
+
+  /***
+   * the CLOCK_MONOTONIC time in nano-seconds a thread sleeping by uthread_sleep_usecs wakes
+   * up at, and its position in the DeadlineHeap (-1 when it is not in it).
+   */
+  int64_t wake_deadline;
+  int deadline_index;
+
+  /***
+   * the function a thread spawned by uthread_spawn_arg runs (nullptr for uthread_spawn), its
+   * argument, and its result once it terminated.
+   */
+  thread_arg_entry_point arg_entry;
+  void *arg;
+  void *result;
+
+  /***
+   * set if the thread is deleted when it terminates, and cleared if it waits as a ZOMBIE
+   * until it is joined.
+   */
+  bool detached;
+
+  /***
+   * the statistics of the thread, and the times it last became READY and RUNNING while the
+   * trace runs (0 when it did not).
+   */
+  uthread_stats_t stats;
+  int64_t ready_since, running_since;
+
+  /***
+   * the thread's values of the thread specific data keys.
+   */
+  void *specific[UTHREAD_KEYS_MAX];
 
   /**
-   * a constructor for the thread
+   * a constructor for the thread, which has no stack if none can be allocated (see has_stack)
    * @param t_id the thread's unique id
-   * @param stack_size the size of the stack
+   * @param pool the pool the thread's stack is taken from
    * @param thread_func the function that the thread is doing
+   * @param start the function the thread's context starts at, it runs thread_func
    * @param t_state the thread's state
    */
-  Thread (int t_id, int stack_size, thread_entry_point thread_func, int t_state);
+  Thread (int t_id, StackPool *pool, thread_entry_point thread_func, thread_entry_point start,
+          int t_state);
 
   /**
    *  returns the state od the thread
@@ -89,6 +193,46 @@ class Thread {
    */
   void increase_run_time ();
 
+  /**
+   * returns the function the thread runs
+   * @return the function the thread runs
+   */
+  thread_entry_point get_entry () const;
+
+  /**
+   * gives the thread's stack back to the pool, once the thread does not run anymore
+   */
+  void release_stack ();
+
+  /**
+   * returns whether the thread has a stack of its own, false for the main thread and for a
+   * thread whose stack could not be allocated
+   */
+  bool has_stack () const;
+
+  /**
+   * returns the usable size of the thread's stack, 0 for the main thread
+   */
+  size_t stack_size () const;
+
+  /**
+   * returns the depth of the thread's stack that was touched so far, 0 for the main thread
+   */
+  size_t stack_high_water () const;
+
+ private:
+
+  /***
+   * A pointer to the stack memory of the thread (nullptr for the main thread, which runs
+   * on the process stack), and the pool it was taken from.
+   */
+  char *stack;
+  StackPool *stack_pool;
+
+  /***
+   * the function the thread runs.
+   */
+  thread_entry_point entry;
 };
 
 #endif //_THREAD_H_
@@ -0,0 +1,75 @@
+#include "ThreadList.h"
+
+/**
+ * a constructor for an empty list
+ */
+ThreadList::ThreadList() : head(nullptr), tail(nullptr), count(0) {}
+
+/**
+ * adds a thread to the end of the list
+ * @param thread the thread to add, must not be in any list
+ */
+void ThreadList::push_back(Thread *thread) {
+  thread->prev = tail;
+  thread->next = nullptr;
+  if (tail == nullptr) {
+    head = thread;
+  } else {
+    tail->next = thread;
+  }
+  tail = thread;
+  count++;
+}
+
+/**
+ * removes the first thread of the list
+ * @return the first thread, or nullptr if the list is empty
+ */
+Thread *ThreadList::pop_front() {
+  Thread *thread = head;
+  if (thread != nullptr) {
+    remove(thread);
+  }
+  return thread;
+}
+
+/**
+ * removes a thread from the list
+ * @param thread a thread that is in this list
+ */
+void ThreadList::remove(Thread *thread) {
+  if (thread->prev == nullptr) {
+    head = thread->next;
+  } else {
+    thread->prev->next = thread->next;
+  }
+  if (thread->next == nullptr) {
+    tail = thread->prev;
+  } else {
+    thread->next->prev = thread->prev;
+  }
+  thread->prev = thread->next = nullptr;
+  count--;
+}
+
+/**
+ * returns the first thread of the list without removing it
+ * @return the first thread, or nullptr if the list is empty
+ */
+Thread *ThreadList::front() const {
+  return head;
+}
+
+/**
+ * returns true if the list is empty
+ */
+bool ThreadList::empty() const {
+  return head == nullptr;
+}
+
+/**
+ * returns the number of threads in the list
+ */
+int ThreadList::size() const {
+  return count;
+}
@@ -0,0 +1,67 @@
+#ifndef _THREAD_LIST_H_
+#define _THREAD_LIST_H_
+
+#include "Thread.h"
+
+/***
+ * An intrusive doubly linked FIFO list of threads.
+ * The links live inside the Thread (prev, next), so a thread can be in one list at a
+ * time, and pushing, popping and removing from the middle are O(1) and never allocate.
+ */
+class ThreadList {
+
+ private:
+
+  /***
+   * the first and last threads in the list, nullptr when the list is empty.
+   */
+  Thread *head, *tail;
+
+  /***
+   * number of threads in the list.
+   */
+  int count;
+
+ public:
+
+  /**
+   * a constructor for an empty list
+   */
+  ThreadList ();
+
+  /**
+   * adds a thread to the end of the list
+   * @param thread the thread to add, must not be in any list
+   */
+  void push_back (Thread *thread);
+
+  /**
+   * removes the first thread of the list
+   * @return the first thread, or nullptr if the list is empty
+   */
+  Thread *pop_front ();
+
+  /**
+   * removes a thread from the list
+   * @param thread a thread that is in this list
+   */
+  void remove (Thread *thread);
+
+  /**
+   * returns the first thread of the list without removing it
+   * @return the first thread, or nullptr if the list is empty
+   */
+  Thread *front () const;
+
+  /**
+   * returns true if the list is empty
+   */
+  bool empty () const;
+
+  /**
+   * returns the number of threads in the list
+   */
+  int size () const;
+};
+
+#endif //_THREAD_LIST_H_
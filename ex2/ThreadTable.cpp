@@ -0,0 +1,174 @@
+#include "ThreadTable.h"
+#include <cstdlib>
+#include <new>
+
+#define BITS_PER_WORD 64
+#define SEGMENT_WORDS 16
+#define SEGMENT_IDS (SEGMENT_WORDS * BITS_PER_WORD)
+#define ALL_FREE (~(uint64_t) 0)
+#define NO_ID (-1)
+
+/***
+ * SEGMENT_IDS ids: the free id bits, the summary of the non-zero words, the bits of the
+ * ids whose thread is constructed, the control blocks and the threads waiting to join them.
+ */
+struct ThreadTable::Segment {
+  uint64_t summary;
+  uint64_t free_ids[SEGMENT_WORDS];
+  uint64_t live_ids[SEGMENT_WORDS];
+  Block blocks[SEGMENT_IDS];
+  ThreadList joiners[SEGMENT_IDS];
+};
+
+/**
+ * a constructor for an empty table
+ * @param max_threads the limit of the ids
+ */
+ThreadTable::ThreadTable(int max_threads) : limit(max_threads) {}
+
+/**
+ * a destructor for the table, frees the segments without destroying the threads in them
+ */
+ThreadTable::~ThreadTable() {
+  for (Segment *segment : segments) {
+    segment->~Segment();
+    free(segment);
+  }
+}
+
+/**
+ * adds a segment of free ids at the end of the table.
+ * @return false upon failure
+ */
+bool ThreadTable::grow() {
+  // the control blocks are cache line aligned, which operator new does not promise
+  void *memory = nullptr;
+  if (posix_memalign(&memory, alignof(Segment), sizeof(Segment)) != 0) {
+    return false;
+  }
+  auto *segment = new(memory) Segment;
+  int index = (int) segments.size();
+  if (index % BITS_PER_WORD == 0) {
+    free_segments.push_back(0);
+  }
+  segments.push_back(segment);
+  for (int word = 0; word < SEGMENT_WORDS; word++) {
+    segment->free_ids[word] = ALL_FREE;
+    segment->live_ids[word] = 0;
+  }
+  segment->summary = ((uint64_t) 1 << SEGMENT_WORDS) - 1;
+  free_segments[index / BITS_PER_WORD] |= (uint64_t) 1 << (index % BITS_PER_WORD);
+  return true;
+}
+
+/**
+ * takes the minimal free id, growing the table if all of its ids are in use
+ * @return the id, or -1 if all the ids below the limit are in use or memory ran out
+ */
+int ThreadTable::allocate() {
+  int index = NO_ID;
+  for (size_t i = 0; i < free_segments.size() && index == NO_ID; i++) {
+    if (free_segments[i] != 0) {
+      index = (int) i * BITS_PER_WORD + __builtin_ctzll(free_segments[i]);
+    }
+  }
+  if (index == NO_ID) {
+    if (capacity() >= limit || !grow()) {
+      return NO_ID;
+    }
+    index = (int) segments.size() - 1;
+  }
+  Segment *segment = segments[index];
+  int word = __builtin_ctzll(segment->summary);
+  int tid = index * SEGMENT_IDS + word * BITS_PER_WORD + __builtin_ctzll(segment->free_ids[word]);
+  if (tid >= limit) {
+    return NO_ID;
+  }
+  segment->free_ids[word] &= segment->free_ids[word] - 1;
+  if (segment->free_ids[word] == 0) {
+    segment->summary &= ~((uint64_t) 1 << word);
+    if (segment->summary == 0) {
+      free_segments[index / BITS_PER_WORD] &= ~((uint64_t) 1 << (index % BITS_PER_WORD));
+    }
+  }
+  return tid;
+}
+
+/**
+ * frees an id, its thread must not be live
+ * @param tid an id returned by allocate
+ */
+void ThreadTable::release(int tid) {
+  int index = tid / SEGMENT_IDS;
+  int word = tid % SEGMENT_IDS / BITS_PER_WORD;
+  Segment *segment = segments[index];
+  segment->free_ids[word] |= (uint64_t) 1 << (tid % BITS_PER_WORD);
+  segment->summary |= (uint64_t) 1 << word;
+  free_segments[index / BITS_PER_WORD] |= (uint64_t) 1 << (index % BITS_PER_WORD);
+}
+
+/**
+ * returns the thread with the given id
+ * @param tid any id
+ * @return the thread, or nullptr if the id is not in use or its thread is not live
+ */
+Thread *ThreadTable::get(int tid) const {
+  if (tid < 0 || tid >= capacity()) {
+    return nullptr;
+  }
+  Segment *segment = segments[tid / SEGMENT_IDS];
+  int word = tid % SEGMENT_IDS / BITS_PER_WORD;
+  if ((segment->live_ids[word] & ((uint64_t) 1 << (tid % BITS_PER_WORD))) == 0) {
+    return nullptr;
+  }
+  return (Thread *) &segment->blocks[tid % SEGMENT_IDS];
+}
+
+/**
+ * returns the memory of the control block of an id that is in use, to construct its thread in
+ * @param tid the id
+ */
+void *ThreadTable::block(int tid) {
+  return &segments[tid / SEGMENT_IDS]->blocks[tid % SEGMENT_IDS];
+}
+
+/**
+ * marks the thread of an id that is in use as live, once it is constructed, or as not
+ * live before it is destroyed
+ * @param tid the id
+ * @param live whether get returns the thread
+ */
+void ThreadTable::set_live(int tid, bool live) {
+  uint64_t &bits = segments[tid / SEGMENT_IDS]->live_ids[tid % SEGMENT_IDS / BITS_PER_WORD];
+  uint64_t bit = (uint64_t) 1 << (tid % BITS_PER_WORD);
+  bits = live ? bits | bit : bits & ~bit;
+}
+
+/**
+ * returns the list of the threads waiting to join the thread with an id that is in use
+ */
+ThreadList &ThreadTable::joiners(int tid) {
+  return segments[tid / SEGMENT_IDS]->joiners[tid % SEGMENT_IDS];
+}
+
+/**
+ * returns the number of ids the table holds, every id in use is below it
+ */
+int ThreadTable::capacity() const {
+  return (int) segments.size() * SEGMENT_IDS;
+}
+
+/**
+ * returns the limit of the ids
+ */
+int ThreadTable::get_limit() const {
+  return limit;
+}
+
+/**
+ * changes the limit of the ids, the ids in use above it stay until they are released
+ * @param max_threads the new limit, positive
+ */
+void ThreadTable::set_limit(int max_threads) {
+  limit = max_threads;
+}
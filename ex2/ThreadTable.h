@@ -0,0 +1,123 @@
+#ifndef _THREAD_TABLE_H_
+#define _THREAD_TABLE_H_
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "ThreadList.h"
+
+/***
+ * The threads indexed by their ids, and the ids that are free.
+ * The table is a list of segments of SEGMENT_IDS ids, allocated when the ids in use reach
+ * them, so it grows with the number of threads instead of being sized for the limit up
+ * front. The control blocks of the threads live inline in the segments, cache line
+ * aligned and indexed by id, so spawning a thread does not allocate. The free ids are a
+ * three level bitmap: a bit per id, a word in every segment with a bit per non-empty word
+ * of it, and a bit per segment that has a free id, so the minimal free id is found by a
+ * few ctz's whatever the number of threads is.
+ */
+class ThreadTable {
+
+ private:
+
+  /***
+   * the memory of the control block of a thread, constructed while its id is in use.
+   */
+  typedef std::aligned_storage<sizeof(Thread), alignof(Thread)>::type Block;
+
+  /***
+   * SEGMENT_IDS ids: the free id bits, the summary of the non-zero words, the bits of the
+   * ids whose thread is constructed, the control blocks and the threads waiting to join them.
+   */
+  struct Segment;
+
+  /***
+   * the segments, in the order of their ids.
+   */
+  std::vector<Segment *> segments;
+
+  /***
+   * a bit per segment that has a free id.
+   */
+  std::vector<uint64_t> free_segments;
+
+  /***
+   * the ids must be below the limit.
+   */
+  int limit;
+
+  /***
+   * adds a segment of free ids at the end of the table.
+   * @return false upon failure
+   */
+  bool grow ();
+
+ public:
+
+  /**
+   * a constructor for an empty table
+   * @param max_threads the limit of the ids
+   */
+  explicit ThreadTable (int max_threads);
+
+  /**
+   * a destructor for the table, frees the segments without destroying the threads in them
+   */
+  ~ThreadTable ();
+
+  /**
+   * takes the minimal free id, growing the table if all of its ids are in use
+   * @return the id, or -1 if all the ids below the limit are in use or memory ran out
+   */
+  int allocate ();
+
+  /**
+   * frees an id, its thread must not be live
+   * @param tid an id returned by allocate
+   */
+  void release (int tid);
+
+  /**
+   * returns the thread with the given id
+   * @param tid any id
+   * @return the thread, or nullptr if the id is not in use or its thread is not live
+   */
+  Thread *get (int tid) const;
+
+  /**
+   * returns the memory of the control block of an id that is in use, to construct its thread in
+   * @param tid the id
+   */
+  void *block (int tid);
+
+  /**
+   * marks the thread of an id that is in use as live, once it is constructed, or as not
+   * live before it is destroyed
+   * @param tid the id
+   * @param live whether get returns the thread
+   */
+  void set_live (int tid, bool live);
+
+  /**
+   * returns the list of the threads waiting to join the thread with an id that is in use
+   */
+  ThreadList &joiners (int tid);
+
+  /**
+   * returns the number of ids the table holds, every id in use is below it
+   */
+  int capacity () const;
+
+  /**
+   * returns the limit of the ids
+   */
+  int get_limit () const;
+
+  /**
+   * changes the limit of the ids, the ids in use above it stay until they are released
+   * @param max_threads the new limit, positive
+   */
+  void set_limit (int max_threads);
+};
+
+#endif //_THREAD_TABLE_H_
@@ -0,0 +1,107 @@
+#include "TimerWheel.h"
+
+#define SLOT_MASK (WHEEL_SLOTS - 1)
+#define LEVEL_SHIFT(level) (WHEEL_BITS * (level))
+#define MAX_DELTA ((1 << LEVEL_SHIFT(WHEEL_LEVELS)) - 1)
+
+/**
+ * a constructor for an empty wheel
+ * @param start_tick the current tick
+ */
+TimerWheel::TimerWheel(int start_tick) : now(start_tick), count(0) {}
+
+/**
+ * puts a thread in the slot that matches its wake_time.
+ */
+void TimerWheel::place(Thread *thread) {
+  int delta = thread->wake_time - now;
+  int tick = thread->wake_time;
+  int level = 0;
+  if (delta > MAX_DELTA) {
+    tick = now + MAX_DELTA;
+    level = WHEEL_LEVELS - 1;
+  } else {
+    while (level < WHEEL_LEVELS - 1 && delta >= (1 << LEVEL_SHIFT(level + 1))) {
+      level++;
+    }
+  }
+  ThreadList *slot = &slots[level][(tick >> LEVEL_SHIFT(level)) & SLOT_MASK];
+  slot->push_back(thread);
+  thread->timer_slot = slot;
+}
+
+/**
+ * moves the threads of a slot of a higher level to the lower levels.
+ * called when the index of every lower level wrapped to 0.
+ */
+void TimerWheel::cascade(int level) {
+  ThreadList *slot = &slots[level][(now >> LEVEL_SHIFT(level)) & SLOT_MASK];
+  if (level + 1 < WHEEL_LEVELS && ((now >> LEVEL_SHIFT(level)) & SLOT_MASK) == 0) {
+    cascade(level + 1);
+  }
+  while (!slot->empty()) {
+    place(slot->pop_front());
+  }
+}
+
+/**
+ * adds a thread that should wake up at the given tick
+ * @param thread the thread, must not be in any list
+ * @param wake_tick the tick to wake up at, later than the current tick
+ */
+void TimerWheel::insert(Thread *thread, int wake_tick) {
+  thread->wake_time = wake_tick;
+  place(thread);
+  count++;
+}
+
+/**
+ * removes a thread from the wheel before it expires
+ * @param thread a thread that is in the wheel
+ */
+void TimerWheel::cancel(Thread *thread) {
+  thread->timer_slot->remove(thread);
+  thread->timer_slot = nullptr;
+  count--;
+}
+
+/**
+ * advances the wheel up to the given tick
+ * @param tick the new current tick
+ * @param expired receives the threads whose wake up tick passed, in order
+ */
+void TimerWheel::advance(int tick, ThreadList &expired) {
+  while (now < tick) {
+    now++;
+    if ((now & SLOT_MASK) == 0) {
+      cascade(1);
+    }
+    ThreadList *slot = &slots[0][now & SLOT_MASK];
+    while (!slot->empty()) {
+      Thread *thread = slot->pop_front();
+      thread->timer_slot = nullptr;
+      expired.push_back(thread);
+      count--;
+    }
+  }
+}
+
+/**
+ * returns the first tick advancing the wheel to may expire a thread: the first non empty
+ * slot of level 0, or the next cascade of the higher levels if it comes before it (the
+ * threads of the higher levels expire at it or later). the wheel must not be empty.
+ */
+int TimerWheel::next_tick() const {
+  int tick = now + 1;
+  while ((tick & SLOT_MASK) != 0 && slots[0][tick & SLOT_MASK].empty()) {
+    tick++;
+  }
+  return tick;
+}
+
+/**
+ * returns true if no thread is in the wheel
+ */
+bool TimerWheel::empty() const {
+  return count == 0;
+}
@@ -0,0 +1,92 @@
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include "ThreadList.h"
+
+/***
+ * number of levels of the wheel and slots in every level. level l holds the threads
+ * that expire in less than WHEEL_SLOTS^(l+1) ticks, threads further away are parked in
+ * the last level and put back in place when they get closer.
+ */
+#define WHEEL_LEVELS 4
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+
+/***
+ * A hierarchical timing wheel of sleeping threads, keyed by the tick (quantum) they
+ * should wake up at.
+ * Every slot is a ThreadList, so inserting, cancelling and expiring a thread are O(1)
+ * and never allocate. A thread waits in one wheel slot at a time, using the same links
+ * as the READY list.
+ */
+class TimerWheel {
+
+ private:
+
+  /***
+   * the slots of every level.
+   */
+  ThreadList slots[WHEEL_LEVELS][WHEEL_SLOTS];
+
+  /***
+   * the last tick the wheel processed.
+   */
+  int now;
+
+  /***
+   * number of threads in the wheel.
+   */
+  int count;
+
+  /***
+   * puts a thread in the slot that matches its wake_time.
+   */
+  void place (Thread *thread);
+
+  /***
+   * moves the threads of a slot of a higher level to the lower levels.
+   */
+  void cascade (int level);
+
+ public:
+
+  /**
+   * a constructor for an empty wheel
+   * @param start_tick the current tick
+   */
+  explicit TimerWheel (int start_tick);
+
+  /**
+   * adds a thread that should wake up at the given tick
+   * @param thread the thread, must not be in any list
+   * @param wake_tick the tick to wake up at, later than the current tick
+   */
+  void insert (Thread *thread, int wake_tick);
+
+  /**
+   * removes a thread from the wheel before it expires
+   * @param thread a thread that is in the wheel
+   */
+  void cancel (Thread *thread);
+
+  /**
+   * advances the wheel up to the given tick
+   * @param tick the new current tick
+   * @param expired receives the threads whose wake up tick passed, in order
+   */
+  void advance (int tick, ThreadList &expired);
+
+  /**
+   * returns the first tick advancing the wheel to may expire a thread: the first non empty
+   * slot of level 0, or the next cascade of the higher levels if it comes before it.
+   * the wheel must not be empty.
+   */
+  int next_tick () const;
+
+  /**
+   * returns true if no thread is in the wheel
+   */
+  bool empty () const;
+};
+
+#endif //_TIMER_WHEEL_H_
@@ -0,0 +1,144 @@
+#include "Trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <new>
+#include <vector>
+#include "uthreads_ext.h"
+
+#define NO_THREAD (-1)
+#define NSEC_PER_USEC 1000.0
+
+/***
+ * the names of the switch reasons, indexed by UTHREAD_SWITCH_*.
+ */
+static const char *const REASON_NAMES[] = {"preempt", "wake preempt", "yield", "block", "sleep", "wait", "io",
+                                           "terminate", "idle"};
+
+/**
+ * a constructor for a ring with no room yet
+ */
+TraceRing::TraceRing() : events(nullptr), mask(0), head(0), start_ns(0) {}
+
+/**
+ * a destructor for the ring
+ */
+TraceRing::~TraceRing() {
+  delete[] events;
+}
+
+/**
+ * empties the ring and makes room for capacity events, rounded up to a power of two.
+ * must not be called while events are recorded or dumped.
+ * @param capacity the number of events to keep
+ * @param now_ns the time the trace starts
+ * @return true upon success, false upon failure
+ */
+bool TraceRing::reset(int capacity, int64_t now_ns) {
+  uint64_t size = 1;
+  while (size < (uint64_t) capacity) {
+    size <<= 1;
+  }
+  if (events == nullptr || size != mask + 1) {
+    auto *resized = new(std::nothrow) TraceEvent[size];
+    if (resized == nullptr) {
+      return false;
+    }
+    delete[] events;
+    events = resized;
+    mask = size - 1;
+  }
+  for (uint64_t i = 0; i <= mask; i++) {
+    events[i].seq = 0;
+  }
+  head = 0;
+  start_ns = now_ns;
+  return true;
+}
+
+/**
+ * records a switch, overwriting the oldest event when the ring is full
+ */
+void TraceRing::record(int64_t time_ns, int from, int to, int reason, int worker) {
+  uint64_t position = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+  TraceEvent *event = &events[position & mask];
+  __atomic_store_n(&event->seq, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  event->time_ns = time_ns;
+  event->from = from;
+  event->to = to;
+  event->reason = reason;
+  event->worker = worker;
+  __atomic_store_n(&event->seq, position + 1, __ATOMIC_RELEASE);
+}
+
+/***
+ * writes one slice of a thread running on a worker, from the event that switched it in to
+ * end_ns, when it was switched out for out_reason (-1 if it still runs).
+ */
+static void write_slice(FILE *file, bool *first, const TraceEvent &in, int64_t end_ns, int out_reason,
+                        int64_t start_ns) {
+  fprintf(file, "%s\n{\"name\":\"uthread %d\",\"cat\":\"uthread\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"out\":\"%s\"}}",
+          *first ? "" : ",", in.to, in.worker, (double) (in.time_ns - start_ns) / NSEC_PER_USEC,
+          (double) (end_ns - in.time_ns) / NSEC_PER_USEC,
+          out_reason == NO_THREAD ? "running" : REASON_NAMES[out_reason]);
+  *first = false;
+}
+
+/**
+ * writes the events in the Chrome trace event format (read by chrome://tracing and
+ * Perfetto): every worker is a track, and every time a thread ran on it is a slice
+ * named after the thread, with the reason it was switched out.
+ * @param path the file to write
+ * @param now_ns the end of the slices still running
+ * @return true upon success, false upon failure
+ */
+bool TraceRing::dump(const char *path, int64_t now_ns) const {
+  if (events == nullptr) {
+    return false;
+  }
+  // copy the events that are complete, the ring keeps changing while it is read
+  std::vector<TraceEvent> copy;
+  uint64_t end = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+  uint64_t begin = end > mask + 1 ? end - (mask + 1) : 0;
+  for (uint64_t position = begin; position < end; position++) {
+    const TraceEvent *event = &events[position & mask];
+    if (__atomic_load_n(&event->seq, __ATOMIC_ACQUIRE) != position + 1) {
+      continue;
+    }
+    TraceEvent snapshot = *event;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&event->seq, __ATOMIC_RELAXED) == position + 1) {
+      copy.push_back(snapshot);
+    }
+  }
+  // the events of every worker in the order it recorded them
+  std::stable_sort(copy.begin(), copy.end(), [](const TraceEvent &a, const TraceEvent &b) {
+    return a.worker < b.worker;
+  });
+  FILE *file = fopen(path, "w");
+  if (file == nullptr) {
+    return false;
+  }
+  fprintf(file, "{\"traceEvents\":[");
+  bool first = true;
+  int last_worker = NO_THREAD;
+  for (size_t i = 0; i < copy.size(); i++) {
+    if (copy[i].worker != last_worker) {
+      last_worker = copy[i].worker;
+      fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"worker %d\"}}",
+              first ? "" : ",", last_worker, last_worker);
+      first = false;
+    }
+    if (copy[i].to == NO_THREAD) {
+      continue;
+    }
+    if (i + 1 < copy.size() && copy[i + 1].worker == copy[i].worker) {
+      write_slice(file, &first, copy[i], copy[i + 1].time_ns, copy[i + 1].reason, start_ns);
+    } else {
+      write_slice(file, &first, copy[i], std::max(now_ns, copy[i].time_ns), NO_THREAD, start_ns);
+    }
+  }
+  fprintf(file, "\n],\"displayTimeUnit\":\"ns\"}\n");
+  return fclose(file) == 0;
+}
@@ -0,0 +1,81 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <cstdint>
+
+/***
+ * one switch of a worker: from the thread it ran to the next one (-1 for the idle worker).
+ * seq is the position of the event in the trace plus 1, and 0 while it is being written.
+ */
+struct TraceEvent {
+  uint64_t seq;
+  int64_t time_ns;
+  int from, to;
+  int reason;
+  int worker;
+};
+
+/***
+ * A ring of the last switches of the workers, recorded without locking.
+ * A writer takes a position with an atomic increment and publishes the event by storing
+ * its seq last, so a reader copying the ring while it is written skips the events that
+ * were being written or were overwritten meanwhile, instead of reading them torn.
+ */
+class TraceRing {
+
+ private:
+
+  /***
+   * the events, a power of two of them.
+   */
+  TraceEvent *events;
+  uint64_t mask;
+
+  /***
+   * the number of events recorded so far, the next one goes to events[head & mask].
+   */
+  uint64_t head;
+
+  /***
+   * the time the trace started, in CLOCK_MONOTONIC nano-seconds.
+   */
+  int64_t start_ns;
+
+ public:
+
+  /**
+   * a constructor for a ring with no room yet
+   */
+  TraceRing ();
+
+  /**
+   * a destructor for the ring
+   */
+  ~TraceRing ();
+
+  /**
+   * empties the ring and makes room for capacity events, rounded up to a power of two.
+   * must not be called while events are recorded or dumped.
+   * @param capacity the number of events to keep
+   * @param now_ns the time the trace starts
+   * @return true upon success, false upon failure
+   */
+  bool reset (int capacity, int64_t now_ns);
+
+  /**
+   * records a switch, overwriting the oldest event when the ring is full
+   */
+  void record (int64_t time_ns, int from, int to, int reason, int worker);
+
+  /**
+   * writes the events in the Chrome trace event format (read by chrome://tracing and
+   * Perfetto): every worker is a track, and every time a thread ran on it is a slice
+   * named after the thread, with the reason it was switched out.
+   * @param path the file to write
+   * @param now_ns the end of the slices still running
+   * @return true upon success, false upon failure
+   */
+  bool dump (const char *path, int64_t now_ns) const;
+};
+
+#endif //_TRACE_H_
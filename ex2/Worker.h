@@ -0,0 +1,94 @@
+#ifndef _WORKER_H_
+#define _WORKER_H_
+
+#include <ctime>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include "Context.h"
+#include "SchedPolicy.h"
+#include "SpinLock.h"
+
+#define IO_EVENTS 64
+
+/***
+ * A kernel thread that runs uthreads.
+ * Every worker has a run list of its own, under a lock of its own. A thread that becomes
+ * READY is queued on the worker that made it READY, and a worker whose list is empty
+ * steals from the others, locking only the list it steals from. The workers are cache line
+ * aligned, so the locks and lists of neighbouring workers do not share a line.
+ */
+struct alignas(CACHE_LINE) Worker {
+
+  /***
+   * the worker's index in the workers table.
+   */
+  int index;
+
+  /***
+   * the kernel thread of the worker.
+   */
+  pthread_t pthread;
+
+  /***
+   * the quantum timer of the worker, measuring its cpu time (with more than one worker),
+   * or the real time in tickless mode.
+   */
+  timer_t timer;
+
+  /***
+   * the RUNNING thread of the worker, nullptr while it is idle.
+   */
+  Thread *current;
+
+  /***
+   * the READY threads queued on the worker, in the order of the scheduling policy, the
+   * lock guarding them, and their number, read without the lock by the workers looking
+   * for a thread to steal.
+   */
+  SchedPolicy *run_queue;
+  SpinLock lock;
+  int queued;
+
+  /***
+   * the thread the worker switched out, until the context it switched to runs and
+   * finishes the switch (nullptr otherwise), and whether it terminated itself.
+   */
+  Thread *leaving;
+  bool leaving_dead;
+
+  /***
+   * the quantum length the worker's timer was last started with.
+   */
+  int armed_quantum;
+
+  /***
+   * in tickless mode: set while the worker's timer is started, and while the worker
+   * sleeps in the kernel waiting for a thread.
+   */
+  bool ticking;
+  bool parked;
+
+  /***
+   * in tickless mode: set when a thread became READY on the worker while its RUNNING
+   * thread runs without a timer, the timer is started when the critical section is left.
+   */
+  bool rearm;
+
+  /***
+   * the buffer the worker reads the reactor's events into. it is not on the stack, the
+   * timer signal polls the reactor on the stack of whatever thread it interrupted.
+   */
+  epoll_event io_events[IO_EVENTS];
+
+  /***
+   * the context the worker waits for threads in.
+   */
+  Context idle_context;
+
+  /***
+   * where the registers of a thread that terminated itself are saved when it is switched out.
+   */
+  Context dead_context;
+};
+
+#endif //_WORKER_H_
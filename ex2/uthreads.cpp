@@ -1,38 +1,65 @@
 #include "uthreads.h"
-#include <queue>
-#include <set>
-#include <map>
+#include "uthreads_ext.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
-#include <csetjmp>
+#include <new>
+#include <cerrno>
 #include <csignal>
+#include <ctime>
+#include <pthread.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
 #include <unistd.h>
+#include "Context.h"
+#include "DeadlineHeap.h"
+#include "Reactor.h"
+#include "SchedPolicy.h"
+#include "Scheduler.h"
+#include "SpinLock.h"
+#include "StackPool.h"
 #include "Thread.h"
+#include "ThreadList.h"
+#include "ThreadTable.h"
+#include "TimerWheel.h"
+#include "Trace.h"
+#include "Worker.h"
 
 using namespace std;
 #define SUCCESS 0
 #define FAILURE (-1)
 #define MAIN_THREAD_ID 0
-#define LONG_RETURN_VALUE 1
 #define MIN_QUANTUM 0
-#define SIGNAL_NUM 26
 #define OFFSET 1
-#define SET_JUMP 0
+#define NO_ID (-1)
+#define LAZY_STACKS true
+#define MIN_STACK_CLASS 4096
+#define STACK_CLASSES 15
+#define LARGE_STACKS_CACHED 16
+#define MIN_WORKERS 1
+#define IDLE_SPINS 1000
+#define LOCK_SPINS 1000
+#define USEC_PER_SEC 1000000
+#define NSEC_PER_USEC 1000
+#define NSEC_PER_SEC 1000000000
+#define NO_EXPIRY (-1)
+#define NO_INDEX (-1)
+#define PREEMPT_TIMER 1
+#define PREEMPT_WAKE 2
+#define IO_POLL 0
+#define IO_BLOCK (-1)
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
 
 
-//---------------thread states-----------------------------------------
-#define READY  0
-#define RUNNING 1
-#define BLOCKED 2
-#define SLEEPING 3
-#define SLEEPING_AND_BLOCKED 4
-#define SUICIDE 5
-
 //---------------------error messages---------------------------------
 #define TIMER_ERROR "system error: setitimer error."
 #define SIGACTION_ERROR "system error: sigaction error."
+#define WORKER_ERROR "system error: failed to start a worker thread."
 #define BAD_ALLOC "system error: bad memory allocation"
-#define SIGNAL_FAILURE "system error: signal masking or unmasking failure"
+#define REACTOR_ERROR "system error: epoll error."
 #define WRONG_QUANTUM_ERROR "thread library error: quantum must bo positive integer"
 #define MAX_THREADS_ERROR "thread library error: maximum number of threads reached"
 #define ID_ERROR "thread library error: thread id does not exist"
@@ -40,6 +67,19 @@ using namespace std;
 #define SLEEP_ERROR "thread library error: main thread cant sleep or sleeping time must be positive"
 #define SLEEP_ID_ERROR "thread library error: cant resume a thread that is sleeping"
 #define NULL_ERROR "thread library error: cant create a thread with NULL entry point"
+#define POLICY_ERROR "thread library error: unknown scheduling policy"
+#define PRIORITY_ERROR "thread library error: thread id does not exist or priority out of range"
+#define WORKERS_ERROR "thread library error: number of workers must be between 1 and MAX_WORKERS"
+#define TRACE_START_ERROR "thread library error: the trace already runs or capacity must be positive"
+#define TRACE_STOP_ERROR "thread library error: the trace does not run"
+#define TRACE_DUMP_ERROR "thread library error: no trace was started or cant write the trace file"
+#define STATS_ERROR "thread library error: thread id does not exist or stats is NULL"
+#define MAX_THREADS_LIMIT_ERROR "thread library error: maximum number of threads must be positive"
+#define KEYS_ERROR "thread library error: all the thread specific data keys are in use"
+#define KEY_ERROR "thread library error: thread specific data key does not exist"
+#define SPAWN_EX_ERROR "thread library error: cant create a thread with NULL entry point or a stack above UTHREAD_MAX_STACK_SIZE"
+#define STACK_USAGE_ERROR "thread library error: thread id does not exist or is the main thread"
+#define JOIN_ERROR "thread library error: no joinable thread with this id, or it is joined already or by itself"
 
 //------------------------globals-------------------------------------
 
@@ -50,51 +90,137 @@ using namespace std;
 int QUANTUM_LENGTH = -1;
 
 /**
- * a map holding all the threads in the program.
- * the key is the thread id and the value is a pointer to the thread
+ * a table holding all the threads in the program, indexed by the thread id, the thread
+ * waiting (WAITING) to join each joinable thread, and the ids that are free.
+ * it grows with the number of threads, up to MAX_THREAD_NUM or uthread_set_max_threads.
+ */
+ThreadTable thread_table(MAX_THREAD_NUM);
+
+// With more than one worker the library's data is guarded by spin locks: the table lock,
+// the timer lock, the reactor lock, a lock in every synchronization object, thread and
+// run queue. They are taken inside critical sections and released before switching
+// threads, in this order: the table lock, the locks of the synchronization objects (a
+// condition variable's before its mutex's), the timer or the reactor lock, the locks of
+// the threads, and the lock of one run queue (or of all of them, in the order of the
+// workers). A thread waiting in a list is locked with the list's lock held by the thread
+// that takes it out; the other way around, the list's lock is only tried (lock_thread).
+// With one worker the locks are not taken, the critical section is enough.
+
+/**
+ * guards the thread table, the stack pools, and the results and the joiners of the
+ * threads. every call that finds a thread by its id holds it, which keeps the thread from
+ * being deleted meanwhile.
+ */
+SpinLock table_lock;
+
+/**
+ * guards the sleep wheel and the deadline heap
+ */
+SpinLock timer_lock;
+
+/**
+ * guards the reactor
+ */
+SpinLock io_lock;
+
+/**
+ * a timing wheel holding all the threads that are in SLEEPING state,
+ * keyed by the quantum number to wake up at
+ */
+TimerWheel sleep_wheel(1);
+
+/**
+ * a heap holding all the threads that are in SLEEPING state by uthread_sleep_usecs,
+ * keyed by the CLOCK_MONOTONIC time to wake up at
+ */
+DeadlineHeap deadline_heap;
+
+/**
+ * the epoll reactor holding all the threads that are in IO_WAIT state
+ */
+Reactor reactor;
+
+/**
+ * the kernel threads running the threads, each one with a list of the READY threads
+ * queued on it. worker 0 is the kernel thread that called uthread_init.
+ */
+Worker workers[MAX_WORKERS];
+
+/**
+ * the number of workers
+ */
+int num_workers = MIN_WORKERS;
+
+/**
+ * set by uthread_init_tickless: the timers run on CLOCK_MONOTONIC, one-shot, and only
+ * when a thread has to be preempted or woken up
+ */
+bool tickless = false;
+
+/**
+ * set while the scheduler is traced: the switches are recorded in trace_ring and the
+ * threads' statistics are counted
  */
-map<int, Thread *> thread_map = map<int,Thread*>();
+bool tracing = false;
 
 /**
- * a map holding all the threads that are is SLEEPING state.
- * the key is the quantum number to wake up at and the value is a vector
- * of pointers to thread
+ * the last switches of the workers, while the scheduler is traced
  */
-map<int, set<Thread *>> sleeping_thread_map = map<int,set<Thread *>>();
+TraceRing trace_ring;
 
 /**
- * a set holding the id's of the blocked threads
+ * the number of thread specific data keys created, the keys are 0 to keys_created - 1
  */
-set<int> blocked_threads = set<int> ();
+int keys_created = 0;
 
 /**
- * a set holding the id's of the sleeping threads
+ * the number of workers sleeping in the kernel in tickless mode, changed atomically
  */
-set<int> sleeping_threads = set<int> ();
+int parked_count = 0;
 
 /**
- * a set holding all the available id's
+ * the scheduling policy of the run queues
  */
-set<int> available_num = set<int> ();
+int sched_policy = UTHREAD_POLICY_FIFO;
 
 /**
- * a queue that holds the id's of threads that are in READY state in order of
- * FIFO
+ * the number of threads in the sleep wheel and the deadline heap, changed under the timer
+ * lock and read without it by the workers looking for threads to wake up
  */
-queue<int> ready_queue = queue<int>();
+int sleeping_count = 0;
 
 /**
- * a pointer to the RUNNING thread
+ * the pool the threads' stacks are taken from. Up to MAX_THREAD_NUM free stacks keep their
+ * pages. a thread that terminates itself releases its stack once it was switched out
  */
-Thread *current_thread;
+StackPool stack_pool(STACK_SIZE, MAX_THREAD_NUM, LAZY_STACKS, false);
 
 /**
- * a set that holds the signals to mask
+ * the pools of the stacks of other sizes (uthread_spawn_ex), by size class: class i holds
+ * stacks of MIN_STACK_CLASS << i bytes. A class is created when a thread first asks for
+ * its size, nullptr until then
  */
-sigset_t set2mask;
+StackPool *stack_classes[STACK_CLASSES];
 
 /**
- * the total number of quantum that passed
+ * the worker of the kernel thread
+ */
+__thread Worker *this_worker;
+
+/**
+ * set while the library's data is being changed. the timer signal does not switch
+ * threads then, it only marks the preemption as pending.
+ */
+__thread volatile sig_atomic_t in_critical;
+
+/**
+ * set when the quantum ended inside a critical section, the switch happens when the
+ * critical section is left
+ */
+__thread volatile sig_atomic_t preempt_pending;
+
+/**
+ * the total number of quantum that passed, counted atomically by all the workers
  */
 int total_quantum = 1;
 
@@ -106,354 +232,1625 @@ struct itimerval timer;
 
 //---------------------------------------------------------------------
 
+// A thread can be switched to another worker between any two instructions outside a
+// critical section, so the kernel thread locals are accessed with single %fs relative
+// instructions: an address computed on one worker is never used on another.
 
 /***
- * an empty function for the main thread to be initialized
+ * returns the worker running the calling thread.
  */
-void empty_func()
-{}
+inline Worker *current_worker()
+{
+  Worker *worker;
+  asm volatile("movq %%fs:this_worker@tpoff, %0" : "=r" (worker));
+  return worker;
+}
 
 /***
- * erases the thread from the sleeping_thread_map so it wont be resumed
- * after termination
- * @param tid the thread's id that's needs to be erased
+ * sets the in_critical flag of the calling kernel thread.
  */
-void erase_from_sleeping_map(int tid)
+inline void set_in_critical(int value)
 {
-  for (auto threads : sleeping_thread_map)
-    {
-      for (auto thread : threads.second)
-        {
-          if (thread->get_id() == tid)
-            {
-              threads.second.erase(thread);
-              break;
-            }
-        }
-    }
+  asm volatile("movl %0, %%fs:in_critical@tpoff" : : "r" (value) : "memory");
 }
 
 /***
- * deletes the thread and removes its id from every data container in the program.
- * @param tid of the thread to terminate.
+ * returns the in_critical flag of the calling kernel thread.
  */
-void terminate_thread_helper(int tid)
+inline int get_in_critical()
 {
-  Thread *thread_to_remove = thread_map[tid];
-  thread_map.erase(tid);
-  sleeping_threads.erase(tid);
-  blocked_threads.erase(tid);
-  erase_from_sleeping_map(tid);
-  available_num.insert(tid);
-  delete thread_to_remove;
+  int value;
+  asm volatile("movl %%fs:in_critical@tpoff, %0" : "=r" (value) : : "memory");
+  return value;
 }
 
 /***
- * Initializing the main thread in the program.
+ * sets the preempt_pending flag of the calling kernel thread.
  */
-void init_main_thread()
+inline void set_preempt_pending(int value)
 {
-  uthread_spawn(&empty_func);
-  current_thread = thread_map.find(MAIN_THREAD_ID)->second;
-  current_thread->increase_run_time();
-  current_thread->change_state(RUNNING);
-  ready_queue.pop();
+  asm volatile("movl %0, %%fs:preempt_pending@tpoff" : : "r" (value) : "memory");
 }
 
 /***
- * blocks signals
+ * returns the preempt_pending flag of the calling kernel thread.
  */
-void block_signal()
+inline int get_preempt_pending()
 {
-  if (sigprocmask(SIG_BLOCK, &set2mask, nullptr) < SUCCESS)
-    {
-      cerr << SIGNAL_FAILURE << endl;
-      exit(EXIT_FAILURE);
-    }
+  int value;
+  asm volatile("movl %%fs:preempt_pending@tpoff, %0" : "=r" (value) : : "memory");
+  return value;
 }
 
 /***
- * unblocks signals
+ * returns errno of the calling kernel thread. errno is found through a const function,
+ * so the compiler keeps its address across a call that switches threads; these look it
+ * up on every call, after the thread may have moved to another worker.
  */
-void unblock_signal()
+__attribute__((noinline)) int get_errno()
 {
-  if (sigprocmask(SIG_UNBLOCK, &set2mask, nullptr) < SUCCESS)
-    {
-      cerr << SIGNAL_FAILURE << endl;
-      exit(EXIT_FAILURE);
-    }
+  return errno;
 }
 
 /***
- * Called by every increasing of the total quantum number.
- * Checks if any sleeping thread needs to wake up, by this time.
- * If there is, changing its state according the last state
- * (for SLEEPING_AND_BLOCKED - changes for BLOCKED, for SLEEPING changes to READY).
+ * sets errno of the calling kernel thread, see get_errno.
  */
-void handle_sleepers()
+__attribute__((noinline)) void set_errno(int error)
+{
+  errno = error;
+}
+
+/***
+ * takes a lock of the library's data, with more than one worker.
+ */
+void acquire(SpinLock &lock)
 {
-  if (sleeping_thread_map.find(total_quantum) == sleeping_thread_map.end())
+  if (num_workers != MIN_WORKERS)
     {
-      return;
+      lock.lock();
     }
-  for (auto thread : sleeping_thread_map.find(total_quantum)->second)
+}
+
+/***
+ * takes a lock of the library's data if it is free, with more than one worker.
+ * @return true if the lock was taken (always with one worker)
+ */
+bool try_acquire(SpinLock &lock)
+{
+  return num_workers == MIN_WORKERS || lock.try_lock();
+}
+
+/***
+ * releases a lock of the library's data.
+ */
+void release(SpinLock &lock)
+{
+  if (num_workers != MIN_WORKERS)
     {
-      if (thread->get_state() == SLEEPING_AND_BLOCKED)
-        {
-          thread->change_state(BLOCKED);
-          sleeping_threads.erase(thread->get_id());
-        }
-      else
-        {
-          thread->change_state(READY);
-          sleeping_threads.erase(thread->get_id());
-          ready_queue.push(thread->get_id());
-        }
+      lock.unlock();
     }
-  sleeping_thread_map.erase(total_quantum);
 }
 
 /***
- * finds the next id in the queue
- * @return the next thread's id
+ * returns the total number of quantums.
+ */
+int current_quantum()
+{
+  return __atomic_load_n(&total_quantum, __ATOMIC_RELAXED);
+}
+
+/***
+ * counts quantums that started.
+ */
+void count_quantums(int quantums)
+{
+  __atomic_fetch_add(&total_quantum, quantums, __ATOMIC_RELAXED);
+}
+
+/***
+ * an empty function for the main thread to be initialized
+ */
+void empty_func()
+{}
+
+/***
+ * returns the thread with the given id, with the table lock held.
+ * @param tid the thread's id
+ * @return the thread, or nullptr if no thread with this id exists
  */
-int find_next_id()
+Thread *find_thread(int tid)
 {
-  int next_thread_id = ready_queue.front();
-  ready_queue.pop();
-  while (thread_map.find(next_thread_id) == thread_map.end() ||
-         blocked_threads.find(next_thread_id) != blocked_threads.end() ||
-         sleeping_threads.find(next_thread_id) != sleeping_threads.end())
+  Thread *thread = thread_table.get(tid);
+  // a thread terminated by another worker exists until its worker switches it out, and a
+  // joinable one until it is joined
+  if (thread != nullptr && (thread->get_state() == SUICIDE || thread->get_state() == ZOMBIE))
     {
-      next_thread_id = ready_queue.front();
-      ready_queue.pop();
+      return nullptr;
     }
-  return next_thread_id;
+  return thread;
 }
 
 /***
- * Turns the current thread to READY or deletes it, if its terminate itself,
- * and turns the next ready thread to RUNNING.
- * @param signal
+ * returns the joinable thread with the given id, not deleted yet or a ZOMBIE, with the
+ * table lock held.
+ * @param tid the thread's id
+ * @return the thread, or nullptr if no joinable thread with this id exists
  */
-void switch_threads()
+Thread *find_joinable(int tid)
 {
-  if (current_thread->get_state() == RUNNING)
+  Thread *thread = thread_table.get(tid);
+  // a thread that terminated is deleted by the worker that switched it out, under the
+  // table lock, so a joiner queued before that gets its result
+  if (thread == nullptr || thread->detached)
     {
-      current_thread->change_state(READY);
-      ready_queue.push(current_thread->get_id());
+      return nullptr;
     }
-  if (current_thread->get_state() == SUICIDE)
+  return thread;
+}
+
+/***
+ * returns the number of threads a run queue must have room for: every id in use is below
+ * the capacity of the thread table, and every new id below its limit.
+ */
+int max_queued()
+{
+  return max(thread_table.get_limit(), thread_table.capacity());
+}
+
+/***
+ * returns true if the thread is on a worker right now (even if it was blocked or
+ * terminated by another worker and did not reach the end of its quantum yet), with the
+ * thread locked: a worker stops running it under its lock, and starts running it with
+ * its state changed last.
+ */
+bool on_worker(Thread *thread)
+{
+  return __atomic_load_n(&workers[thread->worker].current, __ATOMIC_RELAXED) == thread;
+}
+
+/***
+ * returns the number of READY threads in all the run queues, read without their locks.
+ */
+int ready_threads()
+{
+  int count = 0;
+  for (int i = 0; i < num_workers; i++)
     {
-      terminate_thread_helper(current_thread->get_id());
+      count += __atomic_load_n(&workers[i].queued, __ATOMIC_RELAXED);
     }
-  int next_thread_id = find_next_id();
-  current_thread = thread_map.find(next_thread_id)->second;
-  current_thread->change_state(RUNNING);
-  current_thread->increase_run_time();
-  unblock_signal();
-  siglongjmp(current_thread->env, LONG_RETURN_VALUE);
+  return count;
 }
 
+void reset_timer(Worker *worker);
+
+int64_t monotonic_nsec();
+
 /***
- * Called by every quantum, switch between the threads and checks if any
- * thread needs to wake up.
- * @param signal
+ * wakes up a worker sleeping in the kernel in tickless mode, if there is one, to take a
+ * READY thread.
  */
-void scheduler(int signal)
+void kick_parked_worker()
 {
-  block_signal();
-  int ret_val = sigsetjmp(current_thread->env, LONG_RETURN_VALUE);
-  if (ret_val != SET_JUMP)
+  // pairs with park_worker: either it sees the thread queued, or this sees it parked
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&parked_count, __ATOMIC_RELAXED) == 0)
     {
-      unblock_signal();
       return;
     }
-  total_quantum++;
-  handle_sleepers();
-  switch_threads();
+  for (int i = 0; i < num_workers; i++)
+    {
+      if (__atomic_exchange_n(&workers[i].parked, false, __ATOMIC_SEQ_CST))
+        {
+          __atomic_fetch_sub(&parked_count, 1, __ATOMIC_SEQ_CST);
+          pthread_kill(workers[i].pthread, SIGVTALRM);
+          return;
+        }
+    }
 }
 
-/**
- * Sets the timer for the library.
+/***
+ * turns a thread to READY and queues it on the calling worker, with the thread locked (or
+ * not seen by any other thread yet).
+ * @param thread the thread
  */
-void set_timer()
+void make_ready(Thread *thread)
 {
-  struct sigaction sa = {0};
-  // Install timer_handler as the signal handler for SIGVTALRM.
-  sa.sa_handler = &scheduler;
-  if (sigaction(SIGVTALRM, &sa, NULL) < SUCCESS)
+  Worker *worker = current_worker();
+  if (tracing)
     {
-      cerr << SIGACTION_ERROR << endl;
+      thread->ready_since = monotonic_nsec();
     }
-  timer.it_value.tv_sec = 0;
-  timer.it_value.tv_usec = QUANTUM_LENGTH;
-  timer.it_interval.tv_sec = 0;
-  timer.it_interval.tv_usec = QUANTUM_LENGTH;
-  // Configure the timer to expire after QUANTUM... */
-  timer.it_value.tv_sec = 0;            // first time interval, seconds part
-  timer.it_value.tv_usec = QUANTUM_LENGTH;        // first time interval, microseconds part
-  // configure the timer to expire every QUANTUM after that.
-  timer.it_interval.tv_sec = 0;;                   // following time intervals, seconds part
-  timer.it_interval.tv_usec = QUANTUM_LENGTH;    // following time intervals, microseconds part
-  // Start a virtual timer. It counts down whenever this process is executing.
-  if (setitimer(ITIMER_VIRTUAL, &timer, NULL))
+  acquire(worker->lock);
+  thread->worker = worker->index;
+  thread->change_state(READY);
+  worker->run_queue->enqueue(thread);
+  __atomic_store_n(&worker->queued, worker->queued + 1, __ATOMIC_RELAXED);
+  bool preempts = worker->current != nullptr && worker->run_queue->preempts(thread, worker->current);
+  release(worker->lock);
+  if (preempts)
     {
-      cerr << TIMER_ERROR << endl;
-      exit(EXIT_FAILURE);
+      set_preempt_pending(PREEMPT_WAKE);
+    }
+  if (tickless && worker->current != nullptr)
+    {
+      // the RUNNING thread may run without a timer, it has to share the cpu now. the timer
+      // is started when the critical section is left, the caller may hold the timer lock
+      if (!worker->ticking)
+        {
+          worker->rearm = true;
+        }
+      kick_parked_worker();
     }
 }
 
-/**
- * @brief initializes the thread library.
- *
- * You may assume that this function is called before any other thread library function, and that it is called
- * exactly once.
- * The input to the function is the length of a quantum in micro-seconds.
- * It is an error to call this function with non-positive quantum_usecs.
- *
- * @return On success, return 0. On failure, return -1.
-*/
-int uthread_init(int quantum_usecs)
+/***
+ * removes a READY thread from the run list it is queued in, with the thread locked.
+ * @param thread the thread
+ * @return false if a worker took it out of the list meanwhile to run it, it is RUNNING then
+ */
+bool remove_ready(Thread *thread)
 {
-  if (quantum_usecs <= MIN_QUANTUM)
-    {
-      cerr << WRONG_QUANTUM_ERROR << endl;
-      return FAILURE;
-    }
-  QUANTUM_LENGTH = quantum_usecs;
-  for (int i = 0; i < MAX_THREAD_NUM; i++)
+  Worker *worker = &workers[thread->worker];
+  acquire(worker->lock);
+  bool queued = thread->get_state() == READY;
+  if (queued)
     {
-      available_num.insert(i);
+      worker->run_queue->remove(thread);
+      __atomic_store_n(&worker->queued, worker->queued - 1, __ATOMIC_RELAXED);
     }
-  sigemptyset(&set2mask);
-  sigaddset(&set2mask, SIGVTALRM);
-  init_main_thread();
-  set_timer();
-  return EXIT_SUCCESS;
+  release(worker->lock);
+  return queued;
 }
 
 /***
- * Finds the minimal id that available.
- * @return The minimal id that available
+ * makes a thread taken out of a run queue the RUNNING thread of a worker, with the queue's
+ * lock held. the state is changed last, so a worker that sees the thread RUNNING finds it
+ * on its worker.
+ * @param queue the run queue the thread was taken from
  */
-int pop_min()
+void claim_thread(Worker *worker, Thread *thread, SchedPolicy *queue)
 {
-  int min_num = *available_num.begin();
-  available_num.erase(*available_num.begin());
-  return min_num;
+  __atomic_store_n(&worker->current, thread, __ATOMIC_RELAXED);
+  thread->worker = worker->index;
+  queue->charge(thread);
+  thread->change_state(RUNNING);
 }
 
-/**
- * @brief Creates a new thread, whose entry point is the function entry_point with the signature
- * void entry_point(void).
- *
- * The thread is added to the end of the READY threads list.
- * The uthread_spawn function should fail if it would cause the number of concurrent threads to exceed the
- * limit (MAX_THREAD_NUM).
- * Each thread should be allocated with a stack_ptr of size STACK_SIZE bytes.
- *
- * @return On success, return the ID of the created thread. On failure, return -1.
-*/
-int uthread_spawn(thread_entry_point entry_point)
+/***
+ * takes the next thread for a worker to run and makes it the worker's RUNNING thread: the
+ * next of its own run queue, or the next of the next worker's run queue that is not
+ * empty. only the queue a thread is taken from is locked.
+ * @return the thread, or nullptr if no thread is READY
+ */
+Thread *pick_next(Worker *worker)
 {
-  block_signal();
-  if (available_num.empty())
-    {
-      cerr << MAX_THREADS_ERROR << endl;
-      unblock_signal();
-      return FAILURE;
-    }
-  if (entry_point == nullptr)
-    {
-      cerr << NULL_ERROR << endl;
-      unblock_signal();
-      return FAILURE;
-    }
-  auto *thread = new(std::nothrow)Thread(pop_min(), STACK_SIZE, entry_point, READY);
-  if (thread == nullptr)
+  for (int i = 0; i < num_workers; i++)
     {
-      cerr << BAD_ALLOC << endl;
-      unblock_signal();
-      return FAILURE;
+      Worker *victim = &workers[(worker->index + i) % num_workers];
+      if (__atomic_load_n(&victim->queued, __ATOMIC_RELAXED) == 0)
+        {
+          continue;
+        }
+      acquire(victim->lock);
+      Thread *thread = victim->run_queue->pick_next();
+      if (thread != nullptr)
+        {
+          __atomic_store_n(&victim->queued, victim->queued - 1, __ATOMIC_RELAXED);
+          claim_thread(worker, thread, victim->run_queue);
+        }
+      release(victim->lock);
+      if (thread != nullptr)
+        {
+          return thread;
+        }
     }
-  ready_queue.push(thread->get_id());
-  thread_map.insert(pair<int, Thread *>(thread->get_id(), thread));
-  unblock_signal();
-  return thread->get_id();
+  return nullptr;
 }
 
 /***
- * Handle thread doing an action on itself.
- * @param state
+ * waits until the worker that switched a thread out saved its registers, before they are
+ * switched to or the thread is deleted. the worker does it right after the switch.
  */
-void self_action(int state)
+void wait_switched_out(Thread *thread)
 {
-  current_thread->change_state(state);
-  if (setitimer(ITIMER_VIRTUAL, &timer, NULL))
+  for (int spins = 0; __atomic_load_n(&thread->on_cpu, __ATOMIC_ACQUIRE); spins++)
     {
-      cerr << TIMER_ERROR << endl;
-      exit(EXIT_FAILURE);
+      // the worker may be off the cpu (more workers than cpus), let it run
+      if (spins < LOCK_SPINS)
+        {
+          __builtin_ia32_pause();
+        }
+      else
+        {
+          sched_yield();
+        }
     }
-  scheduler(SIGNAL_NUM);
 }
 
-/**
- * @brief Terminates the thread with ID tid and deletes it from all relevant control structures.
- *
- * All the resources allocated by the library for this thread should be released. If no thread with ID tid exists it
- * is considered an error. Terminating the main thread (tid == 0) will result in the termination of the entire
- * process using exit(0) (after releasing the assigned library memory).
- *
- * @return The function returns 0 if the thread was successfully terminated and -1 otherwise. If a thread terminates
- * itself or the main thread is terminated, the function does not return.
-*/
-int uthread_terminate(int tid)
+/***
+ * starts the quantum of the RUNNING thread of a worker, whose registers were saved.
+ */
+void start_running(Worker *worker, Thread *thread)
 {
-  block_signal();
-  if (tid == MAIN_THREAD_ID)
+  thread->on_cpu = true;
+  thread->increase_run_time();
+  if (tracing)
     {
-      exit(EXIT_SUCCESS);
+      int64_t now = monotonic_nsec();
+      if (thread->ready_since != 0)
+        {
+          int64_t wait = now - thread->ready_since;
+          thread->stats.wait_ns += wait;
+          thread->stats.max_wait_ns = max(thread->stats.max_wait_ns, wait);
+          thread->ready_since = 0;
+        }
+      thread->running_since = now;
     }
-  if (thread_map.find(tid) == thread_map.end())
+}
+
+/***
+ * counts the end of the time a thread ran, while the scheduler is traced.
+ * @param voluntary the thread called the library to switch itself out
+ */
+void stop_running(Thread *thread, bool voluntary, int64_t now)
+{
+  if (thread->running_since != 0)
     {
-      cerr << ID_ERROR << endl;
-      unblock_signal();
-      return FAILURE;
+      thread->stats.cpu_ns += now - thread->running_since;
+      thread->running_since = 0;
     }
-  if (tid == current_thread->get_id())
+  if (voluntary)
     {
-      self_action(SUICIDE);
+      thread->stats.voluntary_switches++;
     }
   else
     {
-      terminate_thread_helper(tid);
+      thread->stats.involuntary_switches++;
     }
-  unblock_signal();
-  return EXIT_SUCCESS;
 }
 
 /***
- * Block a thread.
- * @param tid The id of the thread to block.
+ * returns why a thread is switched out, by the state it was left in.
+ * @param restart_timer the quantum did not expire
+ * @param voluntary the thread called the library to switch itself out
  */
-void block_thread_helper(int tid)
+int switch_reason(Thread *thread, bool restart_timer, bool voluntary)
 {
-  Thread *thread_to_block = thread_map.find(tid)->second;
-  if (thread_to_block->get_state() == SLEEPING)
+  int state = thread->get_state();
+  if (state == RUNNING)
     {
-      thread_to_block->change_state(SLEEPING_AND_BLOCKED);
+      if (voluntary)
+        {
+          return UTHREAD_SWITCH_YIELD;
+        }
+      return restart_timer ? UTHREAD_SWITCH_WAKE_PREEMPT : UTHREAD_SWITCH_PREEMPT;
     }
-  else
+  if (state == BLOCKED)
     {
-      thread_to_block->change_state(BLOCKED);
+      return UTHREAD_SWITCH_BLOCK;
+    }
+  if (state == SLEEPING)
+    {
+      return UTHREAD_SWITCH_SLEEP;
+    }
+  if (state == WAITING)
+    {
+      return UTHREAD_SWITCH_WAIT;
+    }
+  if (state == IO_WAIT)
+    {
+      return UTHREAD_SWITCH_IO;
     }
-  blocked_threads.insert(tid);
+  return UTHREAD_SWITCH_TERMINATE;
 }
 
-/**
- * @brief Blocks the thread with ID tid. The thread may be resumed later using uthread_resume.
- *
+/***
+ * returns the quantum length of a thread in micro-seconds.
+ */
+int quantum_of(Thread *thread)
+{
+  return thread->quantum_usecs > 0 ? thread->quantum_usecs : QUANTUM_LENGTH;
+}
+
+/***
+ * makes the worker that runs a thread end its quantum now.
+ */
+void preempt_worker(Thread *thread)
+{
+  pthread_kill(workers[thread->worker].pthread, SIGVTALRM);
+}
+
+/***
+ * destroys a thread that does not run anymore and releases its id, with the table lock held.
+ * @param tid the thread's id
+ */
+void reap_thread(int tid)
+{
+  Thread *thread = thread_table.get(tid);
+  thread_table.set_live(tid, false);
+  thread->~Thread();
+  thread_table.release(tid);
+}
+
+/***
+ * Ends the sleep or wait of a thread, that was already taken out of the wheel or the
+ * wait queue under its lock, which is still held: turns it to BLOCKED if it was blocked
+ * meanwhile, and to READY otherwise.
+ * @param thread a SLEEPING, WAITING or IO_WAIT thread
+ */
+void wake_thread(Thread *thread)
+{
+  acquire(thread->lock);
+  thread->wait_queue = nullptr;
+  thread->wait_lock = nullptr;
+  if (thread->blocked)
+    {
+      thread->change_state(BLOCKED);
+    }
+  else
+    {
+      make_ready(thread);
+    }
+  release(thread->lock);
+}
+
+/***
+ * deletes a terminated thread, that is in no list and not on a worker anymore, and releases
+ * its id, with the table lock held. if a thread waits to join it, it gets the result;
+ * any other joinable thread releases its stack and stays as a ZOMBIE until it is joined or
+ * detached.
+ */
+void finish_termination(Thread *thread)
+{
+  int tid = thread->get_id();
+  if (!thread_table.joiners(tid).empty())
+    {
+      Thread *joiner = thread_table.joiners(tid).pop_front();
+      *(void **) joiner->wait_arg = thread->result;
+      wake_thread(joiner);
+    }
+  else if (!thread->detached)
+    {
+      thread->release_stack();
+      thread->change_state(ZOMBIE);
+      return;
+    }
+  reap_thread(tid);
+}
+
+/***
+ * locks a thread of another worker, and the lock of the list it waits in if it waits in
+ * one. the lists are locked before the threads in them, so the list's lock is only tried,
+ * and both are taken again if it is held. Called with the table lock held, which keeps the
+ * thread from being deleted meanwhile.
+ * @return the lock of the list, or nullptr if the thread waits in no list or to join a
+ * thread (the joiners are guarded by the table lock)
+ */
+SpinLock *lock_thread(Thread *thread)
+{
+  for (;;)
+    {
+      acquire(thread->lock);
+      SpinLock *list_lock = thread->wait_lock;
+      if (list_lock == nullptr || list_lock == &table_lock)
+        {
+          return nullptr;
+        }
+      if (try_acquire(*list_lock))
+        {
+          return list_lock;
+        }
+      release(thread->lock);
+      __builtin_ia32_pause();
+    }
+}
+
+/***
+ * takes a thread out of the wait queue or the timers it waits in, with their lock held.
+ */
+void leave_lists(Thread *thread)
+{
+  if (thread->timer_slot != nullptr)
+    {
+      sleep_wheel.cancel(thread);
+      sleeping_count--;
+    }
+  if (thread->deadline_index != NO_INDEX)
+    {
+      deadline_heap.cancel(thread);
+      sleeping_count--;
+    }
+  if (thread->wait_queue != nullptr)
+    {
+      thread->wait_queue->remove(thread);
+      thread->wait_queue = nullptr;
+    }
+  thread->wait_lock = nullptr;
+}
+
+/***
+ * terminates a thread that is not the calling one, with the table lock held: removes it
+ * from every data container in the program and finishes its termination, or leaves that
+ * to its worker if it is on one (it is SUICIDE until then).
+ * @param thread the thread
+ */
+void terminate_thread_helper(Thread *thread)
+{
+  SpinLock *list_lock = lock_thread(thread);
+  thread->result = UTHREAD_CANCELED;
+  leave_lists(thread);
+  bool running = (thread->get_state() == READY && !remove_ready(thread)) || on_worker(thread);
+  thread->change_state(SUICIDE);
+  if (running)
+    {
+      preempt_worker(thread);
+    }
+  release(thread->lock);
+  if (list_lock != nullptr)
+    {
+      release(*list_lock);
+    }
+  if (!running)
+    {
+      // it may have been switched out by a worker that did not save its registers yet
+      wait_switched_out(thread);
+      finish_termination(thread);
+    }
+}
+
+/***
+ * finishes the last switch of the calling worker, in the context it switched to: the
+ * thread it switched out may run on another worker from now on, or is deleted if it
+ * terminated.
+ */
+void finish_switch()
+{
+  Worker *worker = current_worker();
+  Thread *thread = worker->leaving;
+  if (thread == nullptr)
+    {
+      return;
+    }
+  bool dead = worker->leaving_dead;
+  worker->leaving = nullptr;
+  __atomic_store_n(&thread->on_cpu, false, __ATOMIC_RELEASE);
+  if (dead)
+    {
+      acquire(table_lock);
+      finish_termination(thread);
+      release(table_lock);
+    }
+}
+
+void next_quantum(bool restart_timer, bool voluntary);
+
+/***
+ * Initializing the main thread in the program.
+ */
+void init_main_thread()
+{
+  uthread_spawn(&empty_func);
+  Thread *main_thread = thread_table.get(MAIN_THREAD_ID);
+  remove_ready(main_thread);
+  claim_thread(&workers[0], main_thread, workers[0].run_queue);
+  start_running(&workers[0], main_thread);
+}
+
+/***
+ * enters a critical section, the timer signal will not switch threads until it is left.
+ * the calling thread stays on its worker until it leaves, unless it switches itself out.
+ */
+void enter_critical()
+{
+  set_in_critical(1);
+}
+
+/***
+ * leaves a critical section, switching threads if the quantum ended inside it
+ */
+void leave_critical()
+{
+  for (;;)
+    {
+      if (tickless && current_worker()->rearm)
+        {
+          reset_timer(current_worker());
+        }
+      set_in_critical(0);
+      if (!get_preempt_pending())
+        {
+          return;
+        }
+      set_in_critical(1);
+      // the signal may have switched threads between the check and the flag update
+      int pending = get_preempt_pending();
+      if (pending)
+        {
+          // a thread preempted by a wake up did not finish its quantum, the next one
+          // starts a full quantum
+          next_quantum(pending == PREEMPT_WAKE, false);
+        }
+    }
+}
+
+/***
+ * The function every spawned thread starts at: finishes the switch that started it and
+ * leaves its critical section, runs the thread's entry point and terminates the thread if
+ * it returns.
+ */
+void thread_start()
+{
+  finish_switch();
+  Thread *self = current_worker()->current;
+  leave_critical();
+  if (self->arg_entry != nullptr)
+    {
+      uthread_exit(self->arg_entry(self->arg));
+    }
+  self->get_entry()();
+  uthread_terminate(self->get_id());
+}
+
+/***
+ * returns the RUNNING thread of the calling worker.
+ */
+Thread *running_thread()
+{
+  return current_worker()->current;
+}
+
+/***
+ * returns the RUNNING thread outside a critical section, without a lock: only the thread's
+ * own worker changes its current thread, and the in_critical flag keeps the thread on the
+ * worker while it is read.
+ */
+Thread *calling_thread()
+{
+  set_in_critical(1);
+  Thread *self = current_worker()->current;
+  set_in_critical(0);
+  if (get_preempt_pending())
+    {
+      // the quantum ended while the flag was set
+      enter_critical();
+      leave_critical();
+    }
+  return self;
+}
+
+/***
+ * returns the CLOCK_MONOTONIC time in nano-seconds.
+ */
+int64_t monotonic_nsec()
+{
+  struct timespec now = {};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t) now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+}
+
+/***
+ * Called by every increasing of the total quantum number and by idle workers.
+ * Checks if any sleeping thread needs to wake up, by this time, and wakes it up.
+ * A worker that finds another one doing it goes on, the threads that wake up at a
+ * quantum counted meanwhile are woken up at the next one.
+ */
+void handle_sleepers()
+{
+  if (__atomic_load_n(&sleeping_count, __ATOMIC_RELAXED) == 0 || !try_acquire(timer_lock))
+    {
+      return;
+    }
+  ThreadList woken;
+  sleep_wheel.advance(current_quantum(), woken);
+  if (!deadline_heap.empty())
+    {
+      deadline_heap.expire(monotonic_nsec(), woken);
+    }
+  sleeping_count -= woken.size();
+  while (!woken.empty())
+    {
+      wake_thread(woken.pop_front());
+    }
+  release(timer_lock);
+}
+
+/***
+ * Wakes up the threads waiting for the fds of the events.
+ */
+void wake_io(const epoll_event *events, int count)
+{
+  if (count == 0)
+    {
+      return;
+    }
+  acquire(io_lock);
+  ThreadList woken;
+  reactor.dispatch(events, count, woken);
+  while (!woken.empty())
+    {
+      wake_thread(woken.pop_front());
+    }
+  release(io_lock);
+}
+
+/***
+ * Called by every increasing of the total quantum number and by idle workers.
+ * Polls the reactor, if any thread waits for an fd, and wakes up the threads whose fds
+ * are ready.
+ */
+void handle_io()
+{
+  if (!reactor.armed())
+    {
+      return;
+    }
+  epoll_event *events = current_worker()->io_events;
+  wake_io(events, reactor.fetch(events, IO_EVENTS, IO_POLL, nullptr));
+}
+
+/***
+ * Turns the current thread to READY, or deletes it if it was terminated, and turns the
+ * next ready thread to RUNNING. The current thread may be woken up and taken by another
+ * worker as soon as its lock is released here, that worker waits for its registers
+ * (wait_switched_out) in its idle context.
+ * @param restart_timer start a new quantum on the timer even if the quantum length
+ * of the next thread is the one it runs with
+ * @param voluntary the current thread called the library to switch itself out
+ */
+void switch_threads(bool restart_timer, bool voluntary)
+{
+  Worker *worker = current_worker();
+  Thread *prev_thread = worker->current;
+  int prev_id = prev_thread->get_id();
+  int reason = UTHREAD_SWITCH_PREEMPT;
+  int64_t now = 0;
+  acquire(prev_thread->lock);
+  if (tracing)
+    {
+      now = monotonic_nsec();
+      reason = switch_reason(prev_thread, restart_timer, voluntary);
+      stop_running(prev_thread, voluntary, now);
+    }
+  // from here on the thread is not on the worker for the other workers (on_worker). a
+  // thread that waits may have been woken up and taken by another worker already
+  __atomic_store_n(&worker->current, nullptr, __ATOMIC_RELAXED);
+  bool own = prev_thread->worker == worker->index;
+  if (own && prev_thread->get_state() == RUNNING)
+    {
+      make_ready(prev_thread);
+    }
+  worker->leaving = prev_thread;
+  worker->leaving_dead = own && prev_thread->get_state() == SUICIDE;
+  release(prev_thread->lock);
+  // a terminated thread is deleted after the switch, it keeps running on its stack until then
+  Context *prev_context = worker->leaving_dead ? &worker->dead_context : &prev_thread->context;
+  Thread *next_thread = pick_next(worker);
+  if (tracing)
+    {
+      trace_ring.record(now, prev_id, next_thread != nullptr ? next_thread->get_id() : NO_ID, reason,
+                        worker->index);
+    }
+  if (next_thread == nullptr)
+    {
+      context_switch(prev_context, &worker->idle_context);
+      finish_switch();
+      return;
+    }
+  if (next_thread == prev_thread)
+    {
+      // it was the only READY thread, it runs another quantum without a switch
+      worker->leaving = nullptr;
+    }
+  else if (__atomic_load_n(&next_thread->on_cpu, __ATOMIC_ACQUIRE))
+    {
+      // its worker may be waiting for the registers of this thread in the same way, so the
+      // idle context waits for it once they are saved (the thread stays the worker's)
+      context_switch(prev_context, &worker->idle_context);
+      finish_switch();
+      return;
+    }
+  start_running(worker, next_thread);
+  // a tickless timer is one-shot, every quantum starts it again
+  if (restart_timer || tickless || quantum_of(next_thread) != worker->armed_quantum)
+    {
+      reset_timer(worker);
+    }
+  if (next_thread != prev_thread)
+    {
+      context_switch(prev_context, &next_thread->context);
+      finish_switch();
+    }
+}
+
+/***
+ * Starts a new quantum: checks if any thread needs to wake up and switches between
+ * the threads. Must be called inside a critical section without any lock held, returns
+ * when the calling thread is switched back in (still inside it).
+ * @param restart_timer start a new quantum on the timer (the quantum did not expire)
+ * @param voluntary the current thread called the library to switch itself out
+ */
+void next_quantum(bool restart_timer, bool voluntary)
+{
+  count_quantums(1);
+  handle_sleepers();
+  handle_io();
+  // waking threads up may have asked for a preemption, the switch is done here
+  set_preempt_pending(0);
+  switch_threads(restart_timer, voluntary);
+}
+
+/***
+ * Called by every quantum. Switches between the threads, unless the running thread
+ * is inside a critical section, then the switch is deferred until it leaves it.
+ * The handler is installed with SA_NODEFER, so the signal is not masked in the thread
+ * that is switched to.
+ * @param signal
+ */
+void scheduler(int signal)
+{
+  int saved_errno = get_errno();
+  // an idle worker counts the quantum when it looks for work again
+  if (get_in_critical() || current_worker()->current == nullptr)
+    {
+      set_preempt_pending(PREEMPT_TIMER);
+      set_errno(saved_errno);
+      return;
+    }
+  enter_critical();
+  next_quantum(false, false);
+  leave_critical();
+  // the interrupted thread may have been between a system call and reading its errno,
+  // and may run on another worker now
+  set_errno(saved_errno);
+}
+
+/***
+ * Starts the one-shot timer of a worker in tickless mode. A RUNNING thread gets a quantum
+ * only if it has to share the cpu: another thread is READY, or threads sleep by quantums
+ * and the quantums have to be counted. An idle worker wakes up at the quantum the first
+ * of those may wake up at. Both wake up earlier for the first uthread_sleep_usecs
+ * deadline, and the timer is stopped when there is nothing to wait for.
+ * Takes the timer lock.
+ */
+void arm_tickless_timer(Worker *worker)
+{
+  int64_t expiry = NO_EXPIRY;
+  acquire(timer_lock);
+  if (worker->current != nullptr)
+    {
+      if (ready_threads() > 0 || !sleep_wheel.empty())
+        {
+          expiry = (int64_t) worker->armed_quantum * NSEC_PER_USEC;
+        }
+    }
+  else if (!sleep_wheel.empty())
+    {
+      int quantums = sleep_wheel.next_tick() - current_quantum();
+      expiry = (int64_t) quantums * QUANTUM_LENGTH * NSEC_PER_USEC;
+    }
+  if (!deadline_heap.empty())
+    {
+      int64_t until_deadline = deadline_heap.next_deadline() - monotonic_nsec();
+      if (until_deadline <= 0)
+        {
+          until_deadline = 1;
+        }
+      if (expiry == NO_EXPIRY || until_deadline < expiry)
+        {
+          expiry = until_deadline;
+        }
+    }
+  release(timer_lock);
+  if (expiry == NO_EXPIRY && !worker->ticking)
+    {
+      return;
+    }
+  worker->ticking = expiry != NO_EXPIRY;
+  struct itimerspec spec = {};
+  if (worker->ticking)
+    {
+      spec.it_value.tv_sec = expiry / NSEC_PER_SEC;
+      spec.it_value.tv_nsec = expiry % NSEC_PER_SEC;
+    }
+  if (timer_settime(worker->timer, 0, &spec, nullptr) < SUCCESS)
+    {
+      cerr << TIMER_ERROR << endl;
+      exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Starts a new quantum on the timer of a worker, as long as the quantum of its RUNNING
+ * thread. With one worker it is the process' virtual timer, otherwise a timer measuring
+ * the cpu time of the worker's kernel thread. In tickless mode see arm_tickless_timer.
+ */
+void reset_timer(Worker *worker)
+{
+  int quantum = worker->current != nullptr ? quantum_of(worker->current) : QUANTUM_LENGTH;
+  worker->armed_quantum = quantum;
+  worker->rearm = false;
+  if (tickless)
+    {
+      arm_tickless_timer(worker);
+      return;
+    }
+  if (num_workers == MIN_WORKERS)
+    {
+      timer.it_value.tv_sec = quantum / USEC_PER_SEC;
+      timer.it_value.tv_usec = quantum % USEC_PER_SEC;
+      timer.it_interval = timer.it_value;
+      if (setitimer(ITIMER_VIRTUAL, &timer, NULL))
+        {
+          cerr << TIMER_ERROR << endl;
+          exit(EXIT_FAILURE);
+        }
+      return;
+    }
+  struct itimerspec spec = {};
+  spec.it_value.tv_sec = quantum / USEC_PER_SEC;
+  spec.it_value.tv_nsec = (quantum % USEC_PER_SEC) * NSEC_PER_USEC;
+  spec.it_interval = spec.it_value;
+  if (timer_settime(worker->timer, 0, &spec, nullptr) < SUCCESS)
+    {
+      cerr << TIMER_ERROR << endl;
+      exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Creates the timer of a worker, sending SIGVTALRM to the calling kernel thread when it
+ * used a quantum of cpu time (or in tickless mode, when a quantum of real time passed),
+ * and starts it.
+ */
+void create_worker_timer(Worker *worker)
+{
+  struct sigevent event = {};
+  event.sigev_notify = SIGEV_THREAD_ID;
+  event.sigev_signo = SIGVTALRM;
+  event.sigev_notify_thread_id = (pid_t) syscall(SYS_gettid);
+  clockid_t clock = tickless ? CLOCK_MONOTONIC : CLOCK_THREAD_CPUTIME_ID;
+  if (timer_create(clock, &event, &worker->timer) < SUCCESS)
+    {
+      cerr << TIMER_ERROR << endl;
+      exit(EXIT_FAILURE);
+    }
+  reset_timer(worker);
+}
+
+/***
+ * Waits a little for a thread to become READY or for the quantum to end.
+ * The worker spins rather than sleeps: sleeping threads wake up by quantums, and the
+ * quantum timers only run while the worker uses cpu time.
+ */
+void idle_wait()
+{
+  for (int i = 0; i < IDLE_SPINS; i++)
+    {
+      if (ready_threads() > 0 || get_preempt_pending())
+        {
+          return;
+        }
+      __builtin_ia32_pause();
+    }
+  sched_yield();
+}
+
+/***
+ * Sleeps in the kernel until a thread may become READY, in tickless mode: until the timer
+ * of the worker fires for the first sleeping thread, an fd is ready, or another worker
+ * kicks it to take a READY thread. Counts the quantums that passed meanwhile.
+ * Entered and left inside a critical section.
+ */
+void park_worker(Worker *worker)
+{
+  sigset_t timer_signal, old_mask;
+  sigemptyset(&timer_signal);
+  sigaddset(&timer_signal, SIGVTALRM);
+  // the signal is held until the worker sleeps, so a kick can not come between the
+  // check and the sleep, and is delivered by epoll_pwait
+  pthread_sigmask(SIG_BLOCK, &timer_signal, &old_mask);
+  if (get_preempt_pending())
+    {
+      pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+      return;
+    }
+  reset_timer(worker);
+  __atomic_store_n(&worker->parked, true, __ATOMIC_SEQ_CST);
+  __atomic_fetch_add(&parked_count, 1, __ATOMIC_SEQ_CST);
+  // a thread queued before the worker was seen parked would not kick it
+  if (ready_threads() > 0)
+    {
+      if (__atomic_exchange_n(&worker->parked, false, __ATOMIC_SEQ_CST))
+        {
+          __atomic_fetch_sub(&parked_count, 1, __ATOMIC_SEQ_CST);
+        }
+      pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+      return;
+    }
+  int64_t start = monotonic_nsec();
+  set_in_critical(0);
+  epoll_event *events = worker->io_events;
+  int count = reactor.fetch(events, IO_EVENTS, IO_BLOCK, &old_mask);
+  enter_critical();
+  pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+  if (__atomic_exchange_n(&worker->parked, false, __ATOMIC_SEQ_CST))
+    {
+      __atomic_fetch_sub(&parked_count, 1, __ATOMIC_SEQ_CST);
+    }
+  set_preempt_pending(0);
+  count_quantums((int) ((monotonic_nsec() - start) / ((int64_t) QUANTUM_LENGTH * NSEC_PER_USEC)));
+  wake_io(events, count);
+}
+
+/***
+ * The loop a worker runs while it has no thread to run: it starts the threads queued
+ * on it or stolen from the other workers, and waits when there are none.
+ * Entered inside a critical section.
+ */
+void idle_loop()
+{
+  Worker *worker = current_worker();
+  finish_switch();
+  for (;;)
+    {
+      // a thread a switch took before its registers were saved is the worker's already
+      Thread *next_thread = worker->current;
+      if (next_thread == nullptr)
+        {
+          if (get_preempt_pending())
+            {
+              // a quantum ended while the worker was idle
+              set_preempt_pending(0);
+              count_quantums(1);
+            }
+          handle_sleepers();
+          handle_io();
+          next_thread = pick_next(worker);
+          if (next_thread != nullptr)
+            {
+              set_preempt_pending(0);
+              count_quantums(1);
+              handle_sleepers();
+              if (tracing)
+                {
+                  trace_ring.record(monotonic_nsec(), NO_ID, next_thread->get_id(), UTHREAD_SWITCH_IDLE,
+                                    worker->index);
+                }
+            }
+        }
+      if (next_thread != nullptr)
+        {
+          wait_switched_out(next_thread);
+          start_running(worker, next_thread);
+          reset_timer(worker);
+          context_switch(&worker->idle_context, &next_thread->context);
+          finish_switch();
+          continue;
+        }
+      if (tickless)
+        {
+          park_worker(worker);
+          continue;
+        }
+      if (num_workers == MIN_WORKERS && sleep_wheel.empty() && deadline_heap.empty() && reactor.armed())
+        {
+          // only an fd can make a thread READY now, so the worker sleeps in the kernel
+          // until one is ready. the quantum timer does not run meanwhile.
+          epoll_event *events = worker->io_events;
+          wake_io(events, reactor.fetch(events, IO_EVENTS, IO_BLOCK, nullptr));
+          continue;
+        }
+      set_in_critical(0);
+      idle_wait();
+      enter_critical();
+    }
+}
+
+/***
+ * The function of the kernel thread of every worker but worker 0.
+ * @param arg the worker
+ */
+void *worker_main(void *arg)
+{
+  auto *worker = (Worker *) arg;
+  this_worker = worker;
+  create_worker_timer(worker);
+  enter_critical();
+  idle_loop();
+  return nullptr;
+}
+
+/**
+ * Sets the timer for the library.
+ */
+void set_timer()
+{
+  struct sigaction sa = {0};
+  // Install timer_handler as the signal handler for SIGVTALRM.
+  sa.sa_handler = &scheduler;
+  sa.sa_flags = SA_NODEFER;
+  if (sigaction(SIGVTALRM, &sa, NULL) < SUCCESS)
+    {
+      cerr << SIGACTION_ERROR << endl;
+    }
+  timer.it_value.tv_sec = 0;
+  timer.it_value.tv_usec = QUANTUM_LENGTH;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = QUANTUM_LENGTH;
+  // Configure the timer to expire after QUANTUM... */
+  timer.it_value.tv_sec = 0;            // first time interval, seconds part
+  timer.it_value.tv_usec = QUANTUM_LENGTH;        // first time interval, microseconds part
+  // configure the timer to expire every QUANTUM after that.
+  timer.it_interval.tv_sec = 0;;                   // following time intervals, seconds part
+  timer.it_interval.tv_usec = QUANTUM_LENGTH;    // following time intervals, microseconds part
+  // Start a virtual timer. It counts down whenever this process is executing.
+  if (num_workers == MIN_WORKERS && !tickless)
+    {
+      reset_timer(&workers[0]);
+    }
+  else
+    {
+      create_worker_timer(&workers[0]);
+    }
+}
+
+/***
+ * Gives worker 0 a stack to idle on (its kernel thread's own stack belongs to the main
+ * thread, which may wait too), and starts the kernel threads of workers 1 and up.
+ */
+void start_workers()
+{
+  char *idle_stack = stack_pool.allocate();
+  if (idle_stack == nullptr)
+    {
+      cerr << BAD_ALLOC << endl;
+      exit(EXIT_FAILURE);
+    }
+  context_init(&workers[0].idle_context, idle_stack, stack_pool.size(), &idle_loop);
+  for (int i = 1; i < num_workers; i++)
+    {
+      if (pthread_create(&workers[i].pthread, nullptr, &worker_main, &workers[i]) != SUCCESS)
+        {
+          cerr << WORKER_ERROR << endl;
+          exit(EXIT_FAILURE);
+        }
+      pthread_detach(workers[i].pthread);
+    }
+}
+
+/**
+ * @brief initializes the thread library.
+ *
+ * You may assume that this function is called before any other thread library function, and that it is called
+ * exactly once.
+ * The input to the function is the length of a quantum in micro-seconds.
+ * It is an error to call this function with non-positive quantum_usecs.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_init(int quantum_usecs)
+{
+  return uthread_init_workers(quantum_usecs, MIN_WORKERS);
+}
+
+/**
+ * @brief initializes the thread library with num_kernel_threads workers running the threads (see uthreads_ext.h).
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_init_workers(int quantum_usecs, int num_kernel_threads)
+{
+  if (quantum_usecs <= MIN_QUANTUM)
+    {
+      cerr << WRONG_QUANTUM_ERROR << endl;
+      return FAILURE;
+    }
+  if (num_kernel_threads < MIN_WORKERS || num_kernel_threads > MAX_WORKERS)
+    {
+      cerr << WORKERS_ERROR << endl;
+      return FAILURE;
+    }
+  QUANTUM_LENGTH = quantum_usecs;
+  num_workers = num_kernel_threads;
+  for (int i = 0; i < num_workers; i++)
+    {
+      workers[i].index = i;
+      workers[i].current = nullptr;
+      workers[i].run_queue = SchedPolicy::create(sched_policy, max_queued());
+      if (workers[i].run_queue == nullptr)
+        {
+          cerr << BAD_ALLOC << endl;
+          exit(EXIT_FAILURE);
+        }
+    }
+  if (!reactor.init())
+    {
+      cerr << REACTOR_ERROR << endl;
+      exit(EXIT_FAILURE);
+    }
+  workers[0].pthread = pthread_self();
+  this_worker = &workers[0];
+  init_main_thread();
+  set_timer();
+  start_workers();
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief initializes the thread library in tickless mode (see uthreads_ext.h).
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_init_tickless(int quantum_usecs, int num_kernel_threads)
+{
+  tickless = true;
+  if (uthread_init_workers(quantum_usecs, num_kernel_threads) == FAILURE)
+    {
+      tickless = false;
+      return FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
+/***
+ * returns the pool of stacks of at least the given size, creating its size class if it is
+ * the first one. Must be called with the table lock held.
+ * @param size the usable stack size, up to UTHREAD_MAX_STACK_SIZE
+ * @return the pool, or nullptr upon failure (the error is printed)
+ */
+StackPool *stack_pool_for(size_t size)
+{
+  if (size == stack_pool.size())
+    {
+      return &stack_pool;
+    }
+  int index = 0;
+  while (((size_t) MIN_STACK_CLASS << index) < size)
+    {
+      index++;
+    }
+  if (stack_classes[index] == nullptr)
+    {
+      size_t class_size = (size_t) MIN_STACK_CLASS << index;
+      // stacks larger than the default are cached fewer, and reused without their pages
+      bool large = class_size > stack_pool.size();
+      stack_classes[index] = new(std::nothrow) StackPool(class_size, large ? LARGE_STACKS_CACHED : MAX_THREAD_NUM,
+                                                         LAZY_STACKS, large);
+      if (stack_classes[index] == nullptr)
+        {
+          cerr << BAD_ALLOC << endl;
+        }
+    }
+  return stack_classes[index];
+}
+
+/***
+ * creates a thread with the minimal available id and puts it in the thread table. Must be
+ * called with the table lock held.
+ * @param entry_point the function the thread runs
+ * @param pool the pool the thread's stack is taken from
+ * @return the thread, not READY yet, or nullptr upon failure (the error is printed)
+ */
+Thread *create_thread(thread_entry_point entry_point, StackPool *pool)
+{
+  int tid = thread_table.allocate();
+  if (tid == NO_ID)
+    {
+      cerr << MAX_THREADS_ERROR << endl;
+      return nullptr;
+    }
+  // the control block lives in the table, only the stack may run out
+  auto *thread = new(thread_table.block(tid)) Thread(tid, pool, entry_point, &thread_start, READY);
+  if (tid != MAIN_THREAD_ID && !thread->has_stack())
+    {
+      cerr << BAD_ALLOC << endl;
+      thread->~Thread();
+      thread_table.release(tid);
+      return nullptr;
+    }
+  thread_table.set_live(tid, true);
+  return thread;
+}
+
+/***
+ * creates a READY thread running entry_point(arg). Must be called with the table lock held.
+ * @param pool the pool the thread's stack is taken from
+ * @param detached release the thread when it terminates rather than keep it for uthread_join
+ * @return the ID of the thread, or -1 upon failure (the error is printed)
+ */
+int spawn_arg_thread(thread_arg_entry_point entry_point, void *arg, StackPool *pool, bool detached)
+{
+  Thread *thread = create_thread(nullptr, pool);
+  if (thread == nullptr)
+    {
+      return FAILURE;
+    }
+  thread->arg_entry = entry_point;
+  thread->arg = arg;
+  thread->detached = detached;
+  make_ready(thread);
+  return thread->get_id();
+}
+
+/**
+ * @brief Creates a new thread, whose entry point is the function entry_point with the signature
+ * void entry_point(void).
+ *
+ * The thread is added to the end of the READY threads list.
+ * The uthread_spawn function should fail if it would cause the number of concurrent threads to exceed the
+ * limit (MAX_THREAD_NUM, or the limit set by uthread_set_max_threads).
+ * Each thread should be allocated with a stack_ptr of size STACK_SIZE bytes.
+ *
+ * @return On success, return the ID of the created thread. On failure, return -1.
+*/
+int uthread_spawn(thread_entry_point entry_point)
+{
+  enter_critical();
+  if (entry_point == nullptr)
+    {
+      cerr << NULL_ERROR << endl;
+      leave_critical();
+      return FAILURE;
+    }
+  acquire(table_lock);
+  Thread *thread = create_thread(entry_point, &stack_pool);
+  if (thread == nullptr)
+    {
+      release(table_lock);
+      leave_critical();
+      return FAILURE;
+    }
+  make_ready(thread);
+  // once the lock is released another worker may run the thread to its end and delete it
+  int tid = thread->get_id();
+  release(table_lock);
+  leave_critical();
+  return tid;
+}
+
+/**
+ * @brief Creates a new joinable thread running entry_point(arg) (see uthreads_ext.h).
+ *
+ * @return On success, return the ID of the created thread. On failure, return -1.
+*/
+int uthread_spawn_arg(thread_arg_entry_point entry_point, void *arg)
+{
+  enter_critical();
+  if (entry_point == nullptr)
+    {
+      cerr << NULL_ERROR << endl;
+      leave_critical();
+      return FAILURE;
+    }
+  acquire(table_lock);
+  int tid = spawn_arg_thread(entry_point, arg, &stack_pool, false);
+  release(table_lock);
+  leave_critical();
+  return tid;
+}
+
+/**
+ * @brief Creates a new thread running entry_point(arg), with the attributes attr (see uthreads_ext.h).
+ *
+ * @return On success, return the ID of the created thread. On failure, return -1.
+*/
+int uthread_spawn_ex(thread_arg_entry_point entry_point, void *arg, const uthread_attr_t *attr)
+{
+  enter_critical();
+  size_t size = attr != nullptr && attr->stack_size != 0 ? attr->stack_size : UTHREAD_STACK_RESERVE;
+  if (entry_point == nullptr || size > UTHREAD_MAX_STACK_SIZE)
+    {
+      cerr << SPAWN_EX_ERROR << endl;
+      leave_critical();
+      return FAILURE;
+    }
+  acquire(table_lock);
+  StackPool *pool = stack_pool_for(size);
+  if (pool == nullptr)
+    {
+      release(table_lock);
+      leave_critical();
+      return FAILURE;
+    }
+  int tid = spawn_arg_thread(entry_point, arg, pool, attr != nullptr && attr->detached);
+  release(table_lock);
+  leave_critical();
+  return tid;
+}
+
+/***
+ * Ends the process with exit(0), from inside a critical section. With more than one worker
+ * the other workers keep running threads while exit runs the static destructors, which
+ * release the library's data under them, so the streams are flushed and the process ends
+ * with _exit instead.
+ */
+void exit_process()
+{
+  if (num_workers == MIN_WORKERS)
+    {
+      exit(EXIT_SUCCESS);
+    }
+  cout.flush();
+  cerr.flush();
+  fflush(nullptr);
+  _exit(EXIT_SUCCESS);
+}
+
+/***
+ * switches the running thread out, after it changed its state. Must be called inside a
+ * critical section without any lock held.
+ */
+void switch_out()
+{
+  next_quantum(true, true);
+}
+
+/***
+ * Handle thread doing an action on itself.
+ * @param state
+ */
+void self_action(int state)
+{
+  Thread *self = current_worker()->current;
+  acquire(self->lock);
+  if (state == BLOCKED)
+    {
+      self->blocked = true;
+    }
+  // another worker may have blocked or terminated the thread while it was running
+  if (self->get_state() != SUICIDE || state == SUICIDE)
+    {
+      self->change_state(state == RUNNING && self->blocked ? BLOCKED : state);
+    }
+  release(self->lock);
+  switch_out();
+}
+
+/***
+ * locks the running thread to put it to wait, with the lock of the list it waits in held.
+ * @return the thread, or nullptr (and it is not locked) if another worker terminated it,
+ * it only has to switch out then
+ */
+Thread *begin_wait()
+{
+  Thread *self = current_worker()->current;
+  acquire(self->lock);
+  if (self->get_state() == SUICIDE)
+    {
+      release(self->lock);
+      return nullptr;
+    }
+  return self;
+}
+
+/***
+ * puts the running thread, locked by begin_wait and queued in a list, to wait in it.
+ * @param list_lock the lock of the list, which the caller holds
+ */
+void end_wait(Thread *self, int state, SpinLock *list_lock)
+{
+  self->wait_lock = list_lock;
+  self->change_state(state);
+  release(self->lock);
+}
+
+/***
+ * Puts the running thread to wait (WAITING) on a queue until another thread wakes it up,
+ * inside a critical section: queues it, releases the lock of the queue and switches it out.
+ * @param list_lock the lock of the queue, which the caller holds
+ * @param arg what the thread waits with, read by the thread that wakes it up
+ */
+void wait_on(ThreadList *queue, SpinLock *list_lock, void *arg)
+{
+  Thread *self = begin_wait();
+  if (self != nullptr)
+    {
+      self->wait_queue = queue;
+      self->wait_arg = arg;
+      queue->push_back(self);
+      end_wait(self, WAITING, list_lock);
+    }
+  release(*list_lock);
+  switch_out();
+}
+
+/***
+ * Puts the running thread to wait (IO_WAIT) until an fd is readable or writable.
+ * @param fd the fd
+ * @param write wait for the fd to be writable rather than readable
+ * @return 0 when the fd may be ready, -1 if it cant be waited on (errno is set)
+ */
+int wait_fd(int fd, bool write)
+{
+  enter_critical();
+  acquire(io_lock);
+  Thread *self = begin_wait();
+  if (self != nullptr)
+    {
+      if (!reactor.wait(self, fd, write))
+        {
+          int saved_errno = get_errno();
+          release(self->lock);
+          release(io_lock);
+          leave_critical();
+          set_errno(saved_errno);
+          return FAILURE;
+        }
+      end_wait(self, IO_WAIT, &io_lock);
+    }
+  release(io_lock);
+  switch_out();
+  leave_critical();
+  return SUCCESS;
+}
+
+/**
+ * @brief Terminates the thread with ID tid and deletes it from all relevant control structures.
+ *
+ * All the resources allocated by the library for this thread should be released. If no thread with ID tid exists it
+ * is considered an error. Terminating the main thread (tid == 0) will result in the termination of the entire
+ * process using exit(0) (after releasing the assigned library memory).
+ *
+ * @return The function returns 0 if the thread was successfully terminated and -1 otherwise. If a thread terminates
+ * itself or the main thread is terminated, the function does not return.
+*/
+int uthread_terminate(int tid)
+{
+  enter_critical();
+  if (tid == MAIN_THREAD_ID)
+    {
+      exit_process();
+    }
+  acquire(table_lock);
+  Thread *thread = find_thread(tid);
+  if (thread == nullptr)
+    {
+      cerr << ID_ERROR << endl;
+      release(table_lock);
+      leave_critical();
+      return FAILURE;
+    }
+  if (thread == current_worker()->current)
+    {
+      thread->result = UTHREAD_CANCELED;
+      release(table_lock);
+      self_action(SUICIDE);
+    }
+  else
+    {
+      terminate_thread_helper(thread);
+    }
+  release(table_lock);
+  leave_critical();
+  return EXIT_SUCCESS;
+}
+
+/***
+ * Block a thread.
+ * @param tid The id of the thread to block.
+ */
+void block_thread_helper(int tid)
+{
+  Thread *thread_to_block = thread_table.get(tid);
+  acquire(thread_to_block->lock);
+  thread_to_block->blocked = true;
+  // a SLEEPING, WAITING or IO_WAIT thread turns to BLOCKED when it wakes up
+  if (thread_to_block->get_state() == READY && remove_ready(thread_to_block))
+    {
+      thread_to_block->change_state(BLOCKED);
+    }
+  else if (thread_to_block->get_state() == READY || thread_to_block->get_state() == RUNNING)
+    {
+      // taken by a worker meanwhile
+      thread_to_block->change_state(BLOCKED);
+      preempt_worker(thread_to_block);
+    }
+  release(thread_to_block->lock);
+}
+
+/**
+ * @brief Blocks the thread with ID tid. The thread may be resumed later using uthread_resume.
+ *
  * If no thread with ID tid exists it is considered as an error. In addition, it is an error to try blocking the
  * main thread (tid == 0). If a thread blocks itself, a scheduling decision should be made. Blocking a thread in
  * BLOCKED state has no effect and is not considered an error.
@@ -462,27 +1859,32 @@ void block_thread_helper(int tid)
 */
 int uthread_block(int tid)
 {
-  block_signal();
-  if (tid == MAIN_THREAD_ID || (thread_map.find(tid) == thread_map.end()))
+  enter_critical();
+  acquire(table_lock);
+  Thread *thread = find_thread(tid);
+  if (tid == MAIN_THREAD_ID || thread == nullptr)
     {
       cerr << MAIN_OR_ID_BLOCK_ERROR << endl;
-      unblock_signal();
+      release(table_lock);
+      leave_critical();
       return FAILURE;
     }
-  if (blocked_threads.find(tid) != blocked_threads.end())
+  if (thread->blocked)
     {
-      unblock_signal();
+      release(table_lock);
+      leave_critical();
       return EXIT_SUCCESS;
     }
-  if (tid == current_thread->get_id())
+  if (thread == current_worker()->current)
     {
-      blocked_threads.insert(tid);
+      release(table_lock);
       self_action(BLOCKED);
-      unblock_signal();
+      leave_critical();
       return EXIT_SUCCESS;
     }
   block_thread_helper(tid);  //sleeping thread gets blocked
-  unblock_signal();
+  release(table_lock);
+  leave_critical();
   return EXIT_SUCCESS;
 }
 
@@ -497,37 +1899,47 @@ int uthread_block(int tid)
 */
 int uthread_resume(int tid)
 {
-  block_signal();
-  if (thread_map.find(tid) == thread_map.end())
+  enter_critical();
+  acquire(table_lock);
+  Thread *thread_to_unblock = find_thread(tid);
+  if (thread_to_unblock == nullptr)
     {
       cerr << ID_ERROR << endl;
-      unblock_signal();
+      release(table_lock);
+      leave_critical();
       return FAILURE;
     }
-  if (thread_map.find(tid)->second->get_state() == SLEEPING)
+  acquire(thread_to_unblock->lock);
+  release(table_lock);
+  if (thread_to_unblock->get_state() == SLEEPING && !thread_to_unblock->blocked)
     {
       cerr << SLEEP_ID_ERROR << endl;
-      unblock_signal();
+      release(thread_to_unblock->lock);
+      leave_critical();
       return FAILURE;
     }
-  Thread *thread_to_unblock = thread_map.find(tid)->second;
-  if (thread_to_unblock->get_state() == RUNNING || thread_to_unblock->get_state() == READY)
+  if (!thread_to_unblock->blocked)
     {
-      unblock_signal();
+      release(thread_to_unblock->lock);
+      leave_critical();
       return EXIT_SUCCESS;
     }
-  if (thread_to_unblock->get_state() == SLEEPING_AND_BLOCKED)
-    {
-      thread_to_unblock->change_state(SLEEPING);
-      blocked_threads.erase(tid);
-    }
-  else
+  thread_to_unblock->blocked = false;
+  // a SLEEPING, WAITING or IO_WAIT thread turns to READY when it wakes up
+  if (thread_to_unblock->get_state() == BLOCKED)
     {
-      thread_to_unblock->change_state(READY);
-      blocked_threads.erase(thread_to_unblock->get_id());
-      ready_queue.push(tid);
+      if (on_worker(thread_to_unblock))
+        {
+          // blocked by another worker before the end of its quantum
+          thread_to_unblock->change_state(RUNNING);
+        }
+      else
+        {
+          make_ready(thread_to_unblock);
+        }
     }
-  unblock_signal();
+  release(thread_to_unblock->lock);
+  leave_critical();
   return EXIT_SUCCESS;
 }
 
@@ -537,7 +1949,10 @@ int uthread_resume(int tid)
 */
 int uthread_get_tid()
 {
-  return current_thread->get_id();
+  enter_critical();
+  int tid = current_worker()->current->get_id();
+  leave_critical();
+  return tid;
 }
 
 /**
@@ -548,7 +1963,7 @@ int uthread_get_tid()
 */
 int uthread_get_total_quantums()
 {
-  return total_quantum;
+  return current_quantum();
 }
 
 /**
@@ -562,15 +1977,19 @@ int uthread_get_total_quantums()
 */
 int uthread_get_quantums(int tid)
 {
-  block_signal();
-  if (thread_map.find(tid) == thread_map.end())
+  enter_critical();
+  acquire(table_lock);
+  Thread *thread = find_thread(tid);
+  if (thread == nullptr)
     {
       cerr << ID_ERROR << endl;
-      unblock_signal();
+      release(table_lock);
+      leave_critical();
       return FAILURE;
     }
-  int quantum = thread_map.find(tid)->second->get_run_time();
-  unblock_signal();
+  int quantum = thread->get_run_time();
+  release(table_lock);
+  leave_critical();
   return quantum;
 }
 
@@ -587,26 +2006,503 @@ int uthread_get_quantums(int tid)
 */
 int uthread_sleep(int num_quantums)
 {
-  block_signal();
-  if (current_thread->get_id() == MAIN_THREAD_ID || num_quantums <= MIN_QUANTUM)
+  enter_critical();
+  Thread *self = current_worker()->current;
+  if (self->get_id() == MAIN_THREAD_ID || num_quantums <= MIN_QUANTUM)
+    {
+      cerr << SLEEP_ERROR << endl;
+      leave_critical();
+      return FAILURE;
+    }
+  acquire(timer_lock);
+  if (begin_wait() != nullptr)
+    {
+      int time_to_wake_up = current_quantum() + num_quantums + OFFSET;
+      sleep_wheel.insert(self, time_to_wake_up);
+      sleeping_count++;
+      end_wait(self, SLEEPING, &timer_lock);
+    }
+  release(timer_lock);
+  switch_out();
+  leave_critical();
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Blocks the RUNNING thread for at least usecs micro-seconds of real time (see uthreads_ext.h).
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_sleep_usecs(int usecs)
+{
+  enter_critical();
+  Thread *self = current_worker()->current;
+  if (self->get_id() == MAIN_THREAD_ID || usecs <= MIN_QUANTUM)
     {
       cerr << SLEEP_ERROR << endl;
-      unblock_signal();
+      leave_critical();
+      return FAILURE;
+    }
+  acquire(timer_lock);
+  if (begin_wait() != nullptr)
+    {
+      deadline_heap.insert(self, monotonic_nsec() + (int64_t) usecs * NSEC_PER_USEC);
+      sleeping_count++;
+      end_wait(self, SLEEPING, &timer_lock);
+    }
+  release(timer_lock);
+  switch_out();
+  leave_critical();
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Moves the RUNNING thread to the end of the READY threads list and makes a scheduling decision.
+ *
+ * The next thread starts a new quantum. If no other thread is READY the calling thread continues with a new quantum.
+ *
+ * @return 0.
+*/
+int uthread_yield()
+{
+  enter_critical();
+  self_action(RUNNING);
+  leave_critical();
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Sets the scheduling policy, the order the READY threads run in.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_policy(int policy)
+{
+  if (policy < UTHREAD_POLICY_FIFO || policy > UTHREAD_POLICY_FAIR)
+    {
+      cerr << POLICY_ERROR << endl;
+      return FAILURE;
+    }
+  enter_critical();
+  SchedPolicy *queues[MAX_WORKERS];
+  for (int i = 0; i < num_workers; i++)
+    {
+      queues[i] = SchedPolicy::create(policy, max_queued());
+      if (queues[i] == nullptr)
+        {
+          cerr << BAD_ALLOC << endl;
+          for (int j = 0; j < i; j++)
+            {
+              delete queues[j];
+            }
+          leave_critical();
+          return FAILURE;
+        }
+    }
+  // no thread is queued or taken from a queue meanwhile
+  acquire(table_lock);
+  for (int i = 0; i < num_workers; i++)
+    {
+      acquire(workers[i].lock);
+    }
+  for (int i = 0; i < num_workers; i++)
+    {
+      SchedPolicy *old_queue = workers[i].run_queue;
+      while (!old_queue->empty())
+        {
+          queues[i]->enqueue(old_queue->pick_next());
+        }
+      workers[i].run_queue = queues[i];
+      delete old_queue;
+    }
+  sched_policy = policy;
+  for (int i = num_workers - 1; i >= 0; i--)
+    {
+      release(workers[i].lock);
+    }
+  release(table_lock);
+  leave_critical();
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Sets the priority of the thread with ID tid, 0 being the most urgent.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_priority(int tid, int priority)
+{
+  enter_critical();
+  acquire(table_lock);
+  Thread *thread = find_thread(tid);
+  if (thread == nullptr || priority < 0 || priority >= UTHREAD_NUM_PRIORITIES)
+    {
+      cerr << PRIORITY_ERROR << endl;
+      release(table_lock);
+      leave_critical();
+      return FAILURE;
+    }
+  acquire(thread->lock);
+  release(table_lock);
+  if (thread->get_state() != READY || !remove_ready(thread))
+    {
+      thread->priority = priority;
+      release(thread->lock);
+      leave_critical();
+      return EXIT_SUCCESS;
+    }
+  // queue it again under its new priority, on the calling worker
+  thread->priority = priority;
+  make_ready(thread);
+  release(thread->lock);
+  leave_critical();
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Sets the quantum length of the thread with ID tid, in micro-seconds, under every policy.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_quantum(int tid, int quantum_usecs)
+{
+  enter_critical();
+  acquire(table_lock);
+  Thread *thread = find_thread(tid);
+  if (thread == nullptr)
+    {
+      cerr << ID_ERROR << endl;
+      release(table_lock);
+      leave_critical();
+      return FAILURE;
+    }
+  if (quantum_usecs <= MIN_QUANTUM)
+    {
+      cerr << WRONG_QUANTUM_ERROR << endl;
+      release(table_lock);
+      leave_critical();
+      return FAILURE;
+    }
+  thread->quantum_usecs = quantum_usecs;
+  release(table_lock);
+  leave_critical();
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Starts tracing the scheduler (see uthreads_ext.h).
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_trace_start(int capacity)
+{
+  enter_critical();
+  acquire(table_lock);
+  if (tracing || capacity <= 0)
+    {
+      cerr << TRACE_START_ERROR << endl;
+      release(table_lock);
+      leave_critical();
+      return FAILURE;
+    }
+  int64_t now = monotonic_nsec();
+  if (!trace_ring.reset(capacity, now))
+    {
+      cerr << BAD_ALLOC << endl;
+      release(table_lock);
+      leave_critical();
+      return FAILURE;
+    }
+  // the RUNNING threads start counting their cpu time now, the READY ones when they run
+  for (int i = 0; i < num_workers; i++)
+    {
+      Thread *current = __atomic_load_n(&workers[i].current, __ATOMIC_RELAXED);
+      if (current != nullptr)
+        {
+          current->running_since = now;
+        }
+    }
+  tracing = true;
+  release(table_lock);
+  leave_critical();
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Stops the trace, keeping the recorded switches and the statistics (see uthreads_ext.h).
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_trace_stop()
+{
+  enter_critical();
+  acquire(table_lock);
+  if (!tracing)
+    {
+      cerr << TRACE_STOP_ERROR << endl;
+      release(table_lock);
+      leave_critical();
+      return FAILURE;
+    }
+  tracing = false;
+  // a trace started later must not count the time between the traces
+  for (int i = 0; i < thread_table.capacity(); i++)
+    {
+      Thread *thread = thread_table.get(i);
+      if (thread != nullptr)
+        {
+          thread->ready_since = thread->running_since = 0;
+        }
+    }
+  release(table_lock);
+  leave_critical();
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Copies the statistics of the thread with ID tid (see uthreads_ext.h).
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_get_stats(int tid, uthread_stats_t *stats)
+{
+  enter_critical();
+  acquire(table_lock);
+  Thread *thread = find_thread(tid);
+  if (thread == nullptr || stats == nullptr)
+    {
+      cerr << STATS_ERROR << endl;
+      release(table_lock);
+      leave_critical();
+      return FAILURE;
+    }
+  *stats = thread->stats;
+  if (thread->running_since != 0)
+    {
+      stats->cpu_ns += monotonic_nsec() - thread->running_since;
+    }
+  release(table_lock);
+  leave_critical();
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Writes the recorded switches in the Chrome trace event format (see uthreads_ext.h).
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_trace_dump(const char *path)
+{
+  // the ring is read without the lock, the file is written while the threads keep running
+  if (path == nullptr || !trace_ring.dump(path, monotonic_nsec()))
+    {
+      cerr << TRACE_DUMP_ERROR << endl;
+      return FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Waits until the joinable thread with ID tid terminates and releases it (see uthreads_ext.h).
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_join(int tid, void **result)
+{
+  enter_critical();
+  Thread *self = current_worker()->current;
+  acquire(table_lock);
+  Thread *thread = find_joinable(tid);
+  if (thread == nullptr || thread == self || !thread_table.joiners(tid).empty())
+    {
+      cerr << JOIN_ERROR << endl;
+      release(table_lock);
+      leave_critical();
       return FAILURE;
     }
-  int time_to_wake_up = total_quantum + num_quantums + OFFSET;
-  if (sleeping_thread_map.find(time_to_wake_up) == sleeping_thread_map.end())
+  void *value;
+  if (thread->get_state() == ZOMBIE)
     {
-      set<Thread *> temp_sleeping_threads = set<Thread *>();
-      temp_sleeping_threads.insert(current_thread);
-      sleeping_thread_map.insert(pair<int, set<Thread *>>(time_to_wake_up, temp_sleeping_threads));
+      value = thread->result;
+      reap_thread(tid);
+      release(table_lock);
     }
   else
     {
-      set<Thread *> threads_to_wake_up = sleeping_thread_map.find(time_to_wake_up)->second;
-      threads_to_wake_up.insert(current_thread);
+      // the thread passes its result and is released when it terminates
+      wait_on(&thread_table.joiners(tid), &table_lock, &value);
+    }
+  leave_critical();
+  if (result != nullptr)
+    {
+      *result = value;
+    }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Makes the thread with ID tid detached, releasing it if it terminated (see uthreads_ext.h).
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_detach(int tid)
+{
+  enter_critical();
+  acquire(table_lock);
+  Thread *thread = find_joinable(tid);
+  if (thread == nullptr || !thread_table.joiners(tid).empty())
+    {
+      cerr << JOIN_ERROR << endl;
+      release(table_lock);
+      leave_critical();
+      return FAILURE;
+    }
+  thread->detached = true;
+  if (thread->get_state() == ZOMBIE)
+    {
+      reap_thread(tid);
+    }
+  release(table_lock);
+  leave_critical();
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Terminates the RUNNING thread with a result for uthread_join (see uthreads_ext.h).
+ *
+ * @return The function does not return.
+*/
+void uthread_exit(void *result)
+{
+  enter_critical();
+  Thread *self = current_worker()->current;
+  if (self->get_id() == MAIN_THREAD_ID)
+    {
+      exit_process();
+    }
+  // a thread terminated by another worker meanwhile keeps UTHREAD_CANCELED
+  acquire(table_lock);
+  if (self->get_state() != SUICIDE)
+    {
+      self->result = result;
+    }
+  release(table_lock);
+  self_action(SUICIDE);
+}
+
+/**
+ * @brief Changes the maximal number of concurrent threads (see uthreads_ext.h).
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_max_threads(int max_threads)
+{
+  enter_critical();
+  if (max_threads <= 0)
+    {
+      cerr << MAX_THREADS_LIMIT_ERROR << endl;
+      leave_critical();
+      return FAILURE;
+    }
+  acquire(table_lock);
+  for (int i = 0; i < num_workers; i++)
+    {
+      // the run queues must not grow while the timer signal queues threads in them (they
+      // are created with room for the limit if the library is not initialized yet)
+      acquire(workers[i].lock);
+      bool reserved = workers[i].run_queue == nullptr ||
+                      workers[i].run_queue->reserve(max(max_threads, thread_table.capacity()));
+      release(workers[i].lock);
+      if (!reserved)
+        {
+          cerr << BAD_ALLOC << endl;
+          release(table_lock);
+          leave_critical();
+          return FAILURE;
+        }
+    }
+  thread_table.set_limit(max_threads);
+  release(table_lock);
+  leave_critical();
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Creates a thread specific data key (see uthreads_ext.h).
+ *
+ * @return On success, return the key. On failure, return -1.
+*/
+int uthread_key_create()
+{
+  int key = __atomic_load_n(&keys_created, __ATOMIC_RELAXED);
+  do
+    {
+      if (key == UTHREAD_KEYS_MAX)
+        {
+          cerr << KEYS_ERROR << endl;
+          return FAILURE;
+        }
+    }
+  while (!__atomic_compare_exchange_n(&keys_created, &key, key + 1, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+  return key;
+}
+
+/**
+ * @brief Returns the value of key for the RUNNING thread (see uthreads_ext.h).
+ *
+ * @return The value, or NULL if it was not set or key was not created.
+*/
+void *uthread_getspecific(int key)
+{
+  if (key < 0 || key >= __atomic_load_n(&keys_created, __ATOMIC_ACQUIRE))
+    {
+      return nullptr;
+    }
+  return calling_thread()->specific[key];
+}
+
+/**
+ * @brief Sets the value of key for the RUNNING thread (see uthreads_ext.h).
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_setspecific(int key, void *value)
+{
+  if (key < 0 || key >= __atomic_load_n(&keys_created, __ATOMIC_ACQUIRE))
+    {
+      cerr << KEY_ERROR << endl;
+      return FAILURE;
+    }
+  calling_thread()->specific[key] = value;
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Returns how deep the stack of the thread with ID tid was used (see uthreads_ext.h).
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_get_stack_usage(int tid, size_t *high_water, size_t *size)
+{
+  enter_critical();
+  acquire(table_lock);
+  Thread *thread = find_thread(tid);
+  if (thread == nullptr || tid == MAIN_THREAD_ID)
+    {
+      cerr << STACK_USAGE_ERROR << endl;
+      release(table_lock);
+      leave_critical();
+      return FAILURE;
+    }
+  if (high_water != nullptr)
+    {
+      *high_water = thread->stack_high_water();
+    }
+  if (size != nullptr)
+    {
+      *size = thread->stack_size();
     }
-  sleeping_threads.insert(current_thread->get_id());
-  self_action(SLEEPING);
+  release(table_lock);
+  leave_critical();
   return EXIT_SUCCESS;
 }
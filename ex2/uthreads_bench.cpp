@@ -0,0 +1,624 @@
+#include "uthreads.h"
+#include "uthreads_ext.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <pthread.h>
+#include <sched.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * Measures the cost of the library's basic operations: a thread switch, an API call,
+ * spawning threads, resuming a blocked thread and waking up a sleeping one. Every
+ * figure is measured with 10, 100 and MAX_THREAD_NUM live threads, next to pthread and
+ * swapcontext baselines. For the switch all the live threads yield to each other; for
+ * the other operations the extra threads are blocked, so they only fill the library's
+ * tables. Link it with different builds of libuthreads.a to compare them.
+ * Before the report, threads that never call the library are preempted by the timer
+ * signal for a while: the signal and the scheduler run on the interrupted thread's
+ * stack, so a library that needs too much of it crashes the benchmark there.
+ */
+
+#define DEFAULT_ITERATIONS 100000
+#define LONG_QUANTUM 999999
+#define SLEEP_QUANTUM 10000
+#define SLEEP_QUANTUMS 2
+#define SLEEP_SAMPLES 20
+#define PREEMPT_QUANTUM 1000
+#define PREEMPT_ROUNDS 5
+#define BASELINE_STACK_SIZE 65536
+#define NS_PER_US 1000.0
+#define NOT_MEASURED (-1.0)
+
+using namespace std;
+
+/**
+ * the numbers of live threads every figure is measured with.
+ */
+static const int POPULATIONS[] = {10, 100, MAX_THREAD_NUM};
+#define NUM_POPULATIONS ((int) (sizeof(POPULATIONS) / sizeof(POPULATIONS[0])))
+
+/**
+ * the rows of the report.
+ */
+enum {
+  SWITCH_ROW, API_CALL_ROW, SPAWN_ROW, SPAWN_JOIN_ROW, RESUME_ROW, JITTER_MEAN_ROW, JITTER_MAX_ROW,
+  NUM_ROWS
+};
+
+/**
+ * a row of the report: an operation measured at every population and by the baselines.
+ */
+struct Row {
+  const char *name;
+  double populations[NUM_POPULATIONS];
+  double pthread;
+  double swapcontext;
+};
+
+/**
+ * returns the time in nano-seconds since an arbitrary point.
+ */
+double now_ns()
+{
+  return chrono::duration<double, nano>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//---------------------------------uthreads----------------------------------------
+
+/**
+ * yields forever, so every yield of the main thread is a switch there and back.
+ */
+void yielder()
+{
+  for (;;)
+    {
+      uthread_yield();
+    }
+}
+
+/**
+ * an entry point for threads that are terminated before they run.
+ */
+void idle()
+{
+  for (;;)
+    {}
+}
+
+/**
+ * an entry point for threads that run and return at once.
+ */
+void *finish(void *arg)
+{
+  return arg;
+}
+
+/**
+ * spins without calling the library, so it only leaves the cpu when it is preempted.
+ */
+volatile long spins;
+
+void spinner()
+{
+  for (;;)
+    {
+      spins++;
+    }
+}
+
+/**
+ * the time uthread_resume was called, and the resume latencies the blocker measured.
+ */
+volatile double resumed_at;
+double resume_total;
+int resume_count;
+
+/**
+ * blocks itself forever, measuring the time from every resume until it runs.
+ */
+void blocker()
+{
+  int tid = uthread_get_tid();
+  for (;;)
+    {
+      uthread_block(tid);
+      resume_total += now_ns() - resumed_at;
+      resume_count++;
+    }
+}
+
+/**
+ * the wake up errors the sleeper measured, in nano-seconds, and set when it is done.
+ */
+double jitter_total, jitter_max;
+volatile bool sleeper_done;
+
+/**
+ * sleeps SLEEP_SAMPLES times for SLEEP_QUANTUMS quantums, measuring how far from the
+ * requested time it woke up.
+ */
+void sleeper()
+{
+  double requested = (double) SLEEP_QUANTUMS * SLEEP_QUANTUM * NS_PER_US;
+  for (int i = 0; i < SLEEP_SAMPLES; i++)
+    {
+      double start = now_ns();
+      uthread_sleep(SLEEP_QUANTUMS);
+      double error = fabs(now_ns() - start - requested);
+      jitter_total += error;
+      jitter_max = max(jitter_max, error);
+    }
+  sleeper_done = true;
+  uthread_terminate(uthread_get_tid());
+}
+
+/**
+ * spawns count threads running entry_point.
+ * @param block block them before they run
+ */
+vector<int> spawn_many(thread_entry_point entry_point, int count, bool block)
+{
+  vector<int> tids;
+  for (int i = 0; i < count; i++)
+    {
+      int tid = uthread_spawn(entry_point);
+      if (tid < 0)
+        {
+          break;
+        }
+      if (block)
+        {
+          uthread_block(tid);
+        }
+      tids.push_back(tid);
+    }
+  return tids;
+}
+
+/**
+ * terminates the given threads.
+ */
+void terminate_all(const vector<int> &tids)
+{
+  for (int tid : tids)
+    {
+      uthread_terminate(tid);
+    }
+}
+
+/**
+ * @return the time of one switch when population threads yield to each other, in nano-seconds
+ */
+double switch_time(int iterations, int population)
+{
+  vector<int> tids = spawn_many(&yielder, population - 1, false);
+  uthread_yield();
+  // every yield of the main thread is a round over all the yielders
+  int rounds = max(iterations / population, 1);
+  int start_quantum = uthread_get_total_quantums();
+  double start = now_ns();
+  for (int i = 0; i < rounds; i++)
+    {
+      uthread_yield();
+    }
+  double end = now_ns();
+  int switches = uthread_get_total_quantums() - start_quantum;
+  terminate_all(tids);
+  return (end - start) / switches;
+}
+
+/**
+ * @return the time of one uthread_get_quantums call, in nano-seconds
+ */
+double api_call_time(int iterations)
+{
+  volatile int sink = 0;
+  double start = now_ns();
+  for (int i = 0; i < iterations; i++)
+    {
+      sink += uthread_get_quantums(0);
+    }
+  return (now_ns() - start) / iterations;
+}
+
+/**
+ * @return the time of spawning a thread and terminating it before it runs, with population
+ * live threads, in nano-seconds
+ */
+double spawn_time(int iterations, int population)
+{
+  vector<int> tids = spawn_many(&idle, population - 2, true);
+  double start = now_ns();
+  for (int i = 0; i < iterations; i++)
+    {
+      uthread_terminate(uthread_spawn(&idle));
+    }
+  double end = now_ns();
+  terminate_all(tids);
+  return (end - start) / iterations;
+}
+
+/**
+ * @return the time of spawning a joinable thread, running it to its end and joining it,
+ * with population live threads, in nano-seconds
+ */
+double spawn_join_time(int iterations, int population)
+{
+  vector<int> tids = spawn_many(&idle, population - 2, true);
+  double start = now_ns();
+  for (int i = 0; i < iterations; i++)
+    {
+      uthread_join(uthread_spawn_arg(&finish, nullptr), nullptr);
+    }
+  double end = now_ns();
+  terminate_all(tids);
+  return (end - start) / iterations;
+}
+
+/**
+ * @return the time from resuming a blocked thread until it runs, with population live
+ * threads, in nano-seconds
+ */
+double resume_time(int iterations, int population)
+{
+  vector<int> tids = spawn_many(&idle, population - 2, true);
+  int tid = uthread_spawn(&blocker);
+  uthread_yield();
+  resume_total = 0;
+  resume_count = 0;
+  for (int i = 0; i < iterations; i++)
+    {
+      resumed_at = now_ns();
+      uthread_resume(tid);
+      uthread_yield();
+    }
+  uthread_terminate(tid);
+  terminate_all(tids);
+  return resume_total / resume_count;
+}
+
+/**
+ * measures the wake up error of uthread_sleep while the main thread spins, with population
+ * live threads.
+ * @param max_error receives the largest error, in micro-seconds
+ * @return the mean error, in micro-seconds
+ */
+double sleep_jitter(int population, double *max_error)
+{
+  vector<int> tids = spawn_many(&idle, population - 2, true);
+  jitter_total = jitter_max = 0;
+  sleeper_done = false;
+  uthread_set_quantum(0, SLEEP_QUANTUM);
+  uthread_spawn(&sleeper);
+  // the quantums pass while the main thread runs
+  while (!sleeper_done)
+    {}
+  uthread_set_quantum(0, LONG_QUANTUM);
+  terminate_all(tids);
+  *max_error = jitter_max / NS_PER_US;
+  return jitter_total / SLEEP_SAMPLES / NS_PER_US;
+}
+
+/**
+ * lets population - 1 spinning threads and the main thread, all with short quantums, be
+ * preempted PREEMPT_ROUNDS times each.
+ * @return the number of quantums that passed
+ */
+int preemption_check(int population)
+{
+  vector<int> tids = spawn_many(&spinner, population - 1, false);
+  for (int tid : tids)
+    {
+      uthread_set_quantum(tid, PREEMPT_QUANTUM);
+    }
+  uthread_set_quantum(0, PREEMPT_QUANTUM);
+  int start = uthread_get_total_quantums();
+  while (uthread_get_total_quantums() - start < population * PREEMPT_ROUNDS)
+    {}
+  int quantums = uthread_get_total_quantums() - start;
+  uthread_set_quantum(0, LONG_QUANTUM);
+  terminate_all(tids);
+  return quantums;
+}
+
+//---------------------------------pthread-----------------------------------------
+
+/**
+ * the state two pthreads hand a turn back and forth with.
+ */
+struct PingPong {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int turn;
+  int iterations;
+};
+
+/**
+ * yields iterations times.
+ */
+void *pthread_yielder(void *arg)
+{
+  int iterations = *(int *) arg;
+  for (int i = 0; i < iterations; i++)
+    {
+      sched_yield();
+    }
+  return nullptr;
+}
+
+/**
+ * takes turn 1 from the other thread iterations times, waiting on a condition variable.
+ */
+void *pthread_ponger(void *arg)
+{
+  auto *ping_pong = (PingPong *) arg;
+  pthread_mutex_lock(&ping_pong->mutex);
+  for (int i = 0; i < ping_pong->iterations; i++)
+    {
+      while (ping_pong->turn != 1)
+        {
+          pthread_cond_wait(&ping_pong->cond, &ping_pong->mutex);
+        }
+      ping_pong->turn = 0;
+      pthread_cond_signal(&ping_pong->cond);
+    }
+  pthread_mutex_unlock(&ping_pong->mutex);
+  return nullptr;
+}
+
+/**
+ * an entry point for pthreads that return at once.
+ */
+void *pthread_finish(void *arg)
+{
+  return arg;
+}
+
+/**
+ * @return the time of one switch between two pthreads on one cpu that sched_yield to each
+ * other, in nano-seconds
+ */
+double pthread_switch_time(int iterations)
+{
+  pthread_t other;
+  double start = now_ns();
+  if (pthread_create(&other, nullptr, &pthread_yielder, &iterations) != 0)
+    {
+      return NOT_MEASURED;
+    }
+  pthread_yielder(&iterations);
+  pthread_join(other, nullptr);
+  return (now_ns() - start) / (2.0 * iterations);
+}
+
+/**
+ * @return the time of creating a pthread and joining it, in nano-seconds
+ */
+double pthread_spawn_time(int iterations)
+{
+  double start = now_ns();
+  for (int i = 0; i < iterations; i++)
+    {
+      pthread_t thread;
+      if (pthread_create(&thread, nullptr, &pthread_finish, nullptr) != 0)
+        {
+          return NOT_MEASURED;
+        }
+      pthread_join(thread, nullptr);
+    }
+  return (now_ns() - start) / iterations;
+}
+
+/**
+ * @return the time of handing a turn to a pthread waiting on a condition variable on the
+ * same cpu, in nano-seconds
+ */
+double pthread_resume_time(int iterations)
+{
+  PingPong ping_pong = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, iterations};
+  pthread_t other;
+  if (pthread_create(&other, nullptr, &pthread_ponger, &ping_pong) != 0)
+    {
+      return NOT_MEASURED;
+    }
+  double start = now_ns();
+  pthread_mutex_lock(&ping_pong.mutex);
+  for (int i = 0; i < iterations; i++)
+    {
+      ping_pong.turn = 1;
+      pthread_cond_signal(&ping_pong.cond);
+      while (ping_pong.turn != 0)
+        {
+          pthread_cond_wait(&ping_pong.cond, &ping_pong.mutex);
+        }
+    }
+  pthread_mutex_unlock(&ping_pong.mutex);
+  double end = now_ns();
+  pthread_join(other, nullptr);
+  return (end - start) / (2.0 * iterations);
+}
+
+/**
+ * measures the wake up error of usleep for the time uthread_sleep is asked to sleep.
+ * @param max_error receives the largest error, in micro-seconds
+ * @return the mean error, in micro-seconds
+ */
+double pthread_sleep_jitter(double *max_error)
+{
+  double requested = (double) SLEEP_QUANTUMS * SLEEP_QUANTUM * NS_PER_US;
+  double total = 0, largest = 0;
+  for (int i = 0; i < SLEEP_SAMPLES; i++)
+    {
+      double start = now_ns();
+      usleep(SLEEP_QUANTUMS * SLEEP_QUANTUM);
+      double error = fabs(now_ns() - start - requested);
+      total += error;
+      largest = max(largest, error);
+    }
+  *max_error = largest / NS_PER_US;
+  return total / SLEEP_SAMPLES / NS_PER_US;
+}
+
+//---------------------------------swapcontext-------------------------------------
+
+/**
+ * the contexts of the swapcontext baselines.
+ */
+ucontext_t main_context, other_context;
+
+/**
+ * swaps back to the main context forever.
+ */
+void context_yielder()
+{
+  for (;;)
+    {
+      swapcontext(&other_context, &main_context);
+    }
+}
+
+/**
+ * an entry point for contexts that return at once, to uc_link.
+ */
+void context_finish()
+{}
+
+/**
+ * @return the time of one swapcontext between two contexts, in nano-seconds
+ */
+double swapcontext_switch_time(int iterations)
+{
+  vector<char> stack(BASELINE_STACK_SIZE);
+  getcontext(&other_context);
+  other_context.uc_stack.ss_sp = stack.data();
+  other_context.uc_stack.ss_size = stack.size();
+  other_context.uc_link = nullptr;
+  makecontext(&other_context, &context_yielder, 0);
+  double start = now_ns();
+  for (int i = 0; i < iterations; i++)
+    {
+      swapcontext(&main_context, &other_context);
+    }
+  return (now_ns() - start) / (2.0 * iterations);
+}
+
+/**
+ * @return the time of making a context on a new stack and running it to its end, in
+ * nano-seconds
+ */
+double swapcontext_spawn_time(int iterations)
+{
+  double start = now_ns();
+  for (int i = 0; i < iterations; i++)
+    {
+      void *stack = malloc(BASELINE_STACK_SIZE);
+      getcontext(&other_context);
+      other_context.uc_stack.ss_sp = stack;
+      other_context.uc_stack.ss_size = BASELINE_STACK_SIZE;
+      other_context.uc_link = &main_context;
+      makecontext(&other_context, &context_finish, 0);
+      swapcontext(&main_context, &other_context);
+      free(stack);
+    }
+  return (now_ns() - start) / iterations;
+}
+
+//---------------------------------report------------------------------------------
+
+/**
+ * prints a figure, or a dash if it was not measured.
+ */
+void print_figure(double figure)
+{
+  if (figure < 0)
+    {
+      printf(" %11s", "-");
+    }
+  else
+    {
+      printf(" %11.1f", figure);
+    }
+}
+
+/**
+ * prints the report.
+ */
+void print_rows(const Row *rows, int num_rows)
+{
+  printf("%-26s", "operation");
+  for (int population : POPULATIONS)
+    {
+      printf(" %8d thr", population);
+    }
+  printf(" %11s %11s\n", "pthread", "swapcontext");
+  for (int i = 0; i < num_rows; i++)
+    {
+      printf("%-26s", rows[i].name);
+      for (double figure : rows[i].populations)
+        {
+          print_figure(figure);
+        }
+      print_figure(rows[i].pthread);
+      print_figure(rows[i].swapcontext);
+      printf("\n");
+    }
+}
+
+/**
+ * usage: uthreads_bench [iterations]
+ */
+int main(int argc, char *argv[])
+{
+  int iterations = argc > 1 ? atoi(argv[1]) : DEFAULT_ITERATIONS;
+  if (iterations <= 0)
+    {
+      fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  Row rows[NUM_ROWS] = {
+      {"switch (ns)", {}, NOT_MEASURED, NOT_MEASURED},
+      {"api call (ns)", {}, NOT_MEASURED, NOT_MEASURED},
+      {"spawn + terminate (ns)", {}, NOT_MEASURED, NOT_MEASURED},
+      {"spawn + run + join (ns)", {}, NOT_MEASURED, NOT_MEASURED},
+      {"resume to run (ns)", {}, NOT_MEASURED, NOT_MEASURED},
+      {"sleep jitter mean (us)", {}, NOT_MEASURED, NOT_MEASURED},
+      {"sleep jitter max (us)", {}, NOT_MEASURED, NOT_MEASURED},
+  };
+  // the baselines run before the library starts its timer signal, which could reach them
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(sched_getcpu(), &cpus);
+  sched_setaffinity(0, sizeof(cpus), &cpus);
+  rows[SWITCH_ROW].pthread = pthread_switch_time(iterations);
+  rows[SPAWN_JOIN_ROW].pthread = pthread_spawn_time(iterations / 10);
+  rows[RESUME_ROW].pthread = pthread_resume_time(iterations);
+  rows[JITTER_MEAN_ROW].pthread = pthread_sleep_jitter(&rows[JITTER_MAX_ROW].pthread);
+  rows[SWITCH_ROW].swapcontext = swapcontext_switch_time(iterations);
+  rows[SPAWN_JOIN_ROW].swapcontext = swapcontext_spawn_time(iterations);
+  if (uthread_init(LONG_QUANTUM) != 0)
+    {
+      return EXIT_FAILURE;
+    }
+  for (int population : POPULATIONS)
+    {
+      printf("preempted %d spinning threads for %d quantums\n", population - 1, preemption_check(population));
+    }
+  for (int i = 0; i < NUM_POPULATIONS; i++)
+    {
+      int population = POPULATIONS[i];
+      rows[SWITCH_ROW].populations[i] = switch_time(iterations, population);
+      rows[API_CALL_ROW].populations[i] = api_call_time(iterations);
+      rows[SPAWN_ROW].populations[i] = spawn_time(iterations, population);
+      rows[SPAWN_JOIN_ROW].populations[i] = spawn_join_time(iterations, population);
+      rows[RESUME_ROW].populations[i] = resume_time(iterations, population);
+      rows[JITTER_MEAN_ROW].populations[i] = sleep_jitter(population, &rows[JITTER_MAX_ROW].populations[i]);
+    }
+  print_rows(rows, NUM_ROWS);
+  uthread_terminate(0);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,297 @@
+#ifndef _UTHREADS_EXT_H
+#define _UTHREADS_EXT_H
+
+/*
+ * Extensions of the uthreads library, beyond the interface of uthreads.h.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include "uthreads.h"
+
+#define MAX_WORKERS 64 /* maximal number of kernel threads running the threads */
+
+/* scheduling policies */
+#define UTHREAD_POLICY_FIFO 0 /* round robin, the default */
+#define UTHREAD_POLICY_PRIORITY 1 /* multi-level priority queues */
+#define UTHREAD_POLICY_FAIR 2 /* fair share by run time weighted by priority */
+
+#define UTHREAD_NUM_PRIORITIES 8 /* priorities are 0 (most urgent) to UTHREAD_NUM_PRIORITIES - 1 */
+#define UTHREAD_DEFAULT_PRIORITY 4
+
+#define UTHREAD_KEYS_MAX 16 /* the number of thread specific data keys */
+
+/* the reasons a worker switches threads, recorded by the switch trace */
+#define UTHREAD_SWITCH_PREEMPT 0 /* the quantum of the thread ended */
+#define UTHREAD_SWITCH_WAKE_PREEMPT 1 /* a thread that became READY preempted it */
+#define UTHREAD_SWITCH_YIELD 2
+#define UTHREAD_SWITCH_BLOCK 3
+#define UTHREAD_SWITCH_SLEEP 4
+#define UTHREAD_SWITCH_WAIT 5 /* on a mutex, condition variable, semaphore, channel or join */
+#define UTHREAD_SWITCH_IO 6
+#define UTHREAD_SWITCH_TERMINATE 7
+#define UTHREAD_SWITCH_IDLE 8 /* the worker had no thread to run */
+
+#define UTHREAD_STACK_RESERVE (1 << 20) /* the stack uthread_spawn_ex reserves if no size is given */
+#define UTHREAD_MAX_STACK_SIZE (64 << 20)
+
+/* the attributes of a thread spawned by uthread_spawn_ex */
+typedef struct {
+  size_t stack_size; /* the usable stack size in bytes, 0 for UTHREAD_STACK_RESERVE */
+  int detached; /* non-zero to release the thread when it terminates, like uthread_spawn */
+} uthread_attr_t;
+
+/* the result uthread_join returns for a thread terminated by uthread_terminate */
+#define UTHREAD_CANCELED ((void *) -1)
+
+/* the entry point of a thread spawned by uthread_spawn_arg */
+typedef void *(*thread_arg_entry_point)(void *);
+
+/* the statistics of a thread, counted while the trace runs */
+typedef struct {
+  int64_t cpu_ns; /* time the thread was RUNNING */
+  int64_t wait_ns; /* time the thread was READY, waiting in a run queue */
+  int64_t max_wait_ns; /* the longest single wait in a run queue */
+  int voluntary_switches; /* the thread yielded, blocked, slept, waited or terminated itself */
+  int involuntary_switches; /* the thread was preempted, or blocked or terminated by another thread */
+} uthread_stats_t;
+
+/**
+ * @brief Moves the RUNNING thread to the end of the READY threads list and makes a scheduling decision.
+ *
+ * The next thread starts a new quantum. If no other thread is READY the calling thread continues with a new quantum.
+ *
+ * @return 0.
+*/
+int uthread_yield();
+
+/**
+ * @brief Blocks the RUNNING thread for at least usecs micro-seconds of real time.
+ *
+ * Like uthread_sleep, but by a deadline on CLOCK_MONOTONIC rather than a number of quantums. The thread wakes up at
+ * the first quantum that starts after the deadline, or at the deadline itself in tickless mode. It is an error if
+ * the main thread calls this function or usecs is not positive.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_sleep_usecs(int usecs);
+
+/**
+ * @brief initializes the thread library to run the threads on num_workers kernel threads (M:N scheduling).
+ *
+ * Called instead of uthread_init, which is the same as num_workers == 1. The calling kernel thread is the first
+ * worker. Every worker has its own list of READY threads and its own quantum timer, counting the cpu time of the
+ * worker, and a worker that has no READY thread takes one from the list of another worker. A thread may continue
+ * on a different worker after every switch, so it must not keep kernel thread local data (errno, for example)
+ * across library calls. Blocking or terminating a thread that is RUNNING on another worker ends the quantum of that
+ * worker. With more than one worker, terminating the main thread flushes the standard streams and ends the process
+ * with _exit(0), without the atexit handlers and static destructors, since the other workers still run threads.
+ * With num_workers == 1 the library behaves exactly as with uthread_init.
+ * It is an error to call this function with non-positive quantum_usecs, or num_workers not between 1 and
+ * MAX_WORKERS.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_init_workers(int quantum_usecs, int num_workers);
+
+/**
+ * @brief initializes the thread library in tickless mode, on num_workers kernel threads.
+ *
+ * Called instead of uthread_init or uthread_init_workers. The quantums are measured in real time (CLOCK_MONOTONIC)
+ * by one-shot timers, started only when a quantum has to end: a RUNNING thread that no READY thread waits for runs
+ * without a timer, unless threads sleep by uthread_sleep and the quantums have to be counted. A worker with no thread
+ * to run sleeps in the kernel until the first sleeping thread wakes up, an fd is ready or a thread becomes READY,
+ * and the quantums that passed meanwhile are counted. Threads sleeping by uthread_sleep_usecs wake up at their
+ * deadline rather than at the next quantum.
+ * It is an error to call this function with non-positive quantum_usecs, or num_workers not between 1 and
+ * MAX_WORKERS.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_init_tickless(int quantum_usecs, int num_workers);
+
+/**
+ * @brief Sets the scheduling policy, the order the READY threads run in.
+ *
+ * UTHREAD_POLICY_FIFO runs the READY threads in the order they became READY (the behaviour of uthreads.h).
+ * UTHREAD_POLICY_PRIORITY runs the READY threads of the most urgent priority first, round robin among themselves,
+ * and a thread that becomes READY preempts a RUNNING thread of a less urgent priority at once.
+ * UTHREAD_POLICY_FAIR gives every thread a share of the quantums weighted by its priority: the READY thread that
+ * ran the fewest weighted quantums runs next, and a thread that becomes READY preempts a RUNNING thread that ran
+ * more than a quantum longer than it.
+ * The READY threads are moved to the new policy. It is an error to pass an unknown policy.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_policy(int policy);
+
+/**
+ * @brief Sets the priority of the thread with ID tid, 0 being the most urgent.
+ *
+ * Used by UTHREAD_POLICY_PRIORITY and UTHREAD_POLICY_FAIR. A READY thread that becomes more urgent than the
+ * calling thread preempts it. It is an error if no thread with ID tid exists or the priority is out of range.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_priority(int tid, int priority);
+
+/**
+ * @brief Sets the quantum length of the thread with ID tid, in micro-seconds, under every policy.
+ *
+ * The thread's next quantums are quantum_usecs long instead of the length given to uthread_init. It is an error if
+ * no thread with ID tid exists or quantum_usecs is not positive.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_quantum(int tid, int quantum_usecs);
+
+/**
+ * @brief Starts tracing the scheduler: recording the switches and counting the statistics of the threads.
+ *
+ * Every switch of a worker is recorded with its time, the thread switched out and the thread switched in (-1 for the
+ * idle worker) and its reason (UTHREAD_SWITCH_*), in a ring that keeps the last capacity switches (rounded up to a
+ * power of two). The statistics of the threads are counted from now on. The trace costs a few clock readings per
+ * switch, and a check of a flag when it is stopped. It is an error to start a running trace or to pass a non-positive
+ * capacity.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_trace_start(int capacity);
+
+/**
+ * @brief Stops the trace. The recorded switches and the statistics are kept.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_trace_stop();
+
+/**
+ * @brief Copies the statistics of the thread with ID tid into stats, including the time it runs now.
+ *
+ * It is an error if no thread with ID tid exists or stats is NULL.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_get_stats(int tid, uthread_stats_t *stats);
+
+/**
+ * @brief Writes the recorded switches to path in the Chrome trace event format (JSON).
+ *
+ * Open the file in chrome://tracing or ui.perfetto.dev: every worker is a track, and every time a thread ran is a
+ * slice with the reason it was switched out. The trace may keep running meanwhile. It is an error if no trace was
+ * started or the file can not be written.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_trace_dump(const char *path);
+
+/**
+ * @brief Creates a thread specific data key.
+ *
+ * Every thread has its own value for every key, NULL until the thread sets it. The values are kept in the thread
+ * itself, so uthread_getspecific and uthread_setspecific are an index into it, without a lock. Keys are
+ * never deleted. It is an error if UTHREAD_KEYS_MAX keys were created already.
+ *
+ * @return On success, return the key. On failure, return -1.
+*/
+int uthread_key_create();
+
+/**
+ * @brief Returns the value of key for the RUNNING thread.
+ *
+ * @return The value last set by the thread, or NULL if it did not set one or key was not created.
+*/
+void *uthread_getspecific(int key);
+
+/**
+ * @brief Sets the value of key for the RUNNING thread.
+ *
+ * It is an error if key was not created by uthread_key_create.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_setspecific(int key, void *value);
+
+/**
+ * @brief Changes the maximal number of concurrent threads, MAX_THREAD_NUM by default.
+ *
+ * May be called before uthread_init. The thread table grows with the number of threads rather than being sized for
+ * the limit, so a large limit costs no memory until threads are spawned. Lowering the limit below the ids in use
+ * does not terminate threads, uthread_spawn fails until the number of threads drops below it. The stacks are carved
+ * out of large mappings, so vm.max_map_count does not cap the threads (see the README). It is an error if
+ * max_threads is not positive.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_set_max_threads(int max_threads);
+
+/**
+ * @brief Creates a new joinable thread, whose entry point is the function entry_point with the signature
+ * void *entry_point(void *), called with arg.
+ *
+ * Like uthread_spawn, but the value entry_point returns (or passes to uthread_exit) is kept for uthread_join. The
+ * thread's stack is released as soon as it terminates, and its id and result once it is joined or detached. The
+ * threads created by uthread_spawn are detached, their ids are released when they terminate.
+ *
+ * @return On success, return the ID of the created thread. On failure, return -1.
+*/
+int uthread_spawn_arg(thread_arg_entry_point entry_point, void *arg);
+
+/**
+ * @brief Creates a new thread running entry_point(arg), with a stack of attr->stack_size bytes.
+ *
+ * Like uthread_spawn_arg, but attr chooses the stack size and whether the thread is detached (NULL for the
+ * defaults: UTHREAD_STACK_RESERVE bytes, joinable). The stacks are reserved in the address space and their pages
+ * are committed only when they are touched, so a large size costs memory only for the depth the thread uses. Stacks
+ * are taken from pools by size class (powers of two), and a reused stack larger than STACK_SIZE gives the pages the
+ * previous thread touched back to the kernel. It is an error if entry_point is NULL or the stack size is above
+ * UTHREAD_MAX_STACK_SIZE.
+ *
+ * @return On success, return the ID of the created thread. On failure, return -1.
+*/
+int uthread_spawn_ex(thread_arg_entry_point entry_point, void *arg, const uthread_attr_t *attr);
+
+/**
+ * @brief Returns how much of the stack of the thread with ID tid was used.
+ *
+ * high_water receives the depth from the top of the stack to its lowest page that is in memory, measured with
+ * mincore, and size the usable size of the stack; either may be NULL. A reused stack of STACK_SIZE or less keeps
+ * the pages the threads that used it before touched, so its high water mark is theirs as well. Below every stack
+ * there is room for the signal frames of preemption, so the high water mark can exceed size. It is an error if no
+ * thread with ID tid exists or it is the main thread, which runs on the process stack.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_get_stack_usage(int tid, size_t *high_water, size_t *size);
+
+/**
+ * @brief Blocks the RUNNING thread until the thread with ID tid terminates, and releases its id.
+ *
+ * The thread waits without using the cpu (WAITING) and is woken up by the termination. If result is not NULL it
+ * receives the value the thread returned, or UTHREAD_CANCELED if it was terminated by uthread_terminate. It is an
+ * error if no joinable thread with ID tid exists, it is the calling thread, or another thread already joins it.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_join(int tid, void **result);
+
+/**
+ * @brief Makes the thread with ID tid detached: its id is released when it terminates, and it can not be joined.
+ *
+ * A thread that already terminated is released now. It is an error if no joinable thread with ID tid exists or
+ * another thread already joins it.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_detach(int tid);
+
+/**
+ * @brief Terminates the RUNNING thread with result, the value uthread_join returns for it.
+ *
+ * The result of a detached thread is ignored. If the main thread calls this function the process ends with exit(0).
+ *
+ * @return The function does not return.
+*/
+void uthread_exit(void *result);
+
+#endif //_UTHREADS_EXT_H
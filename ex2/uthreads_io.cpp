@@ -0,0 +1,100 @@
+#include "uthreads_io.h"
+#include <cerrno>
+#include <unistd.h>
+#include "Scheduler.h"
+
+#define SUCCESS 0
+#define FAILURE (-1)
+#define READABLE false
+#define WRITABLE true
+
+/***
+ * returns true if a call that failed with error should wait for its fd and try again.
+ */
+bool would_block(int error)
+{
+  return error == EAGAIN || error == EWOULDBLOCK;
+}
+
+// wait_fd may move the thread to another worker, so errno is read with get_errno: the
+// address of errno the compiler computed before the wait belongs to the old worker.
+
+ssize_t uthread_read(int fd, void *buf, size_t count)
+{
+  for (;;)
+    {
+      ssize_t ret_val = read(fd, buf, count);
+      int error = get_errno();
+      if (ret_val >= SUCCESS || (error != EINTR && !would_block(error)))
+        {
+          return ret_val;
+        }
+      if (error != EINTR && wait_fd(fd, READABLE) == FAILURE)
+        {
+          return FAILURE;
+        }
+    }
+}
+
+ssize_t uthread_write(int fd, const void *buf, size_t count)
+{
+  for (;;)
+    {
+      ssize_t ret_val = write(fd, buf, count);
+      int error = get_errno();
+      if (ret_val >= SUCCESS || (error != EINTR && !would_block(error)))
+        {
+          return ret_val;
+        }
+      if (error != EINTR && wait_fd(fd, WRITABLE) == FAILURE)
+        {
+          return FAILURE;
+        }
+    }
+}
+
+int uthread_accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen)
+{
+  for (;;)
+    {
+      int ret_val = accept4(sockfd, addr, addrlen, SOCK_NONBLOCK);
+      int error = get_errno();
+      if (ret_val >= SUCCESS || (error != EINTR && error != ECONNABORTED && !would_block(error)))
+        {
+          return ret_val;
+        }
+      if (would_block(error) && wait_fd(sockfd, READABLE) == FAILURE)
+        {
+          return FAILURE;
+        }
+    }
+}
+
+int uthread_connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen)
+{
+  if (connect(sockfd, addr, addrlen) == SUCCESS)
+    {
+      return SUCCESS;
+    }
+  if (get_errno() != EINPROGRESS)
+    {
+      return FAILURE;
+    }
+  if (wait_fd(sockfd, WRITABLE) == FAILURE)
+    {
+      return FAILURE;
+    }
+  // the result of the connection is reported as the pending error of the socket
+  int error = 0;
+  socklen_t length = sizeof(error);
+  if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &length) < SUCCESS)
+    {
+      return FAILURE;
+    }
+  if (error != 0)
+    {
+      set_errno(error);
+      return FAILURE;
+    }
+  return SUCCESS;
+}
@@ -0,0 +1,47 @@
+#ifndef _UTHREADS_IO_H
+#define _UTHREADS_IO_H
+
+/*
+ * I/O for the threads of the uthreads library that does not stop the other threads.
+ * The calls behave like the system calls they wrap, but when the fd is not ready the calling thread waits in the
+ * IO_WAIT state and the other threads run meanwhile. The library polls an epoll instance for the waited fds on every
+ * quantum and whenever a worker has no thread to run, and when nothing but an fd can wake a thread up, a single
+ * worker sleeps in epoll_wait.
+ * The fds must be in non-blocking mode (O_NONBLOCK), a blocking fd stops the whole worker like the plain call.
+ * A thread waiting for an fd may be blocked and resumed like a sleeping thread. errno is set as by the system calls.
+ */
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+/**
+ * @brief Reads up to count bytes from fd, waiting until some data is available.
+ *
+ * @return The number of bytes read (0 at end of file), or -1 upon failure.
+*/
+ssize_t uthread_read(int fd, void *buf, size_t count);
+
+/**
+ * @brief Writes up to count bytes to fd, waiting until some can be written.
+ *
+ * @return The number of bytes written, which may be less than count, or -1 upon failure.
+*/
+ssize_t uthread_write(int fd, const void *buf, size_t count);
+
+/**
+ * @brief Accepts a connection on a listening socket, waiting until one arrives.
+ *
+ * The returned socket is already in non-blocking mode.
+ *
+ * @return The fd of the accepted socket, or -1 upon failure.
+*/
+int uthread_accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen);
+
+/**
+ * @brief Connects a socket, waiting until the connection is established or fails.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen);
+
+#endif //_UTHREADS_IO_H
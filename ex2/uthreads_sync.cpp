@@ -0,0 +1,447 @@
+#include "uthreads_sync.h"
+#include <iostream>
+#include <new>
+#include "Scheduler.h"
+#include "Thread.h"
+#include "ThreadList.h"
+
+using namespace std;
+
+#define SUCCESS 0
+#define FAILURE (-1)
+#define BUSY 1
+#define NO_OWNER (-1)
+
+//---------------error messages----------------------------------------
+#define BAD_ALLOC "system error: bad memory allocation"
+#define NULL_OBJECT_ERROR "thread library error: synchronization object is NULL"
+#define RELOCK_ERROR "thread library error: the mutex is already locked by this thread"
+#define OWNER_ERROR "thread library error: the mutex is not locked by this thread"
+#define SEM_VALUE_ERROR "thread library error: semaphore value must be non negative"
+#define CAPACITY_ERROR "thread library error: channel capacity must be non negative"
+#define CHAN_BUSY_ERROR "thread library error: cant destroy a channel threads are waiting on"
+
+/***
+ * Releases a mutex, handing it directly to its first waiting thread if there is one, with
+ * its guard held.
+ * @param mutex a locked mutex
+ */
+void hand_off(uthread_mutex_t *mutex)
+{
+  Thread *next = mutex->waiters.pop_front();
+  if (next == nullptr)
+    {
+      mutex->owner = NO_OWNER;
+      return;
+    }
+  mutex->owner = next->get_id();
+  wake_thread(next);
+}
+
+int uthread_mutex_init(uthread_mutex_t *mutex)
+{
+  if (mutex == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  new(&mutex->guard) SpinLock();
+  new(&mutex->waiters) ThreadList();
+  mutex->owner = NO_OWNER;
+  return SUCCESS;
+}
+
+int uthread_mutex_lock(uthread_mutex_t *mutex)
+{
+  if (mutex == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  enter_critical();
+  int self = running_thread()->get_id();
+  acquire(mutex->guard);
+  if (mutex->owner == self)
+    {
+      cerr << RELOCK_ERROR << endl;
+      release(mutex->guard);
+      leave_critical();
+      return FAILURE;
+    }
+  if (mutex->owner == NO_OWNER)
+    {
+      mutex->owner = self;
+      release(mutex->guard);
+    }
+  else
+    {
+      // the unlocking thread makes this thread the owner before waking it up
+      wait_on(&mutex->waiters, &mutex->guard, nullptr);
+    }
+  leave_critical();
+  return SUCCESS;
+}
+
+int uthread_mutex_trylock(uthread_mutex_t *mutex)
+{
+  if (mutex == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  enter_critical();
+  int ret_val = BUSY;
+  acquire(mutex->guard);
+  if (mutex->owner == NO_OWNER)
+    {
+      mutex->owner = running_thread()->get_id();
+      ret_val = SUCCESS;
+    }
+  release(mutex->guard);
+  leave_critical();
+  return ret_val;
+}
+
+int uthread_mutex_unlock(uthread_mutex_t *mutex)
+{
+  if (mutex == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  enter_critical();
+  acquire(mutex->guard);
+  if (mutex->owner != running_thread()->get_id())
+    {
+      cerr << OWNER_ERROR << endl;
+      release(mutex->guard);
+      leave_critical();
+      return FAILURE;
+    }
+  hand_off(mutex);
+  release(mutex->guard);
+  leave_critical();
+  return SUCCESS;
+}
+
+int uthread_cond_init(uthread_cond_t *cond)
+{
+  if (cond == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  new(&cond->guard) SpinLock();
+  new(&cond->waiters) ThreadList();
+  return SUCCESS;
+}
+
+int uthread_cond_wait(uthread_cond_t *cond, uthread_mutex_t *mutex)
+{
+  if (cond == nullptr || mutex == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  enter_critical();
+  acquire(cond->guard);
+  acquire(mutex->guard);
+  if (mutex->owner != running_thread()->get_id())
+    {
+      cerr << OWNER_ERROR << endl;
+      release(mutex->guard);
+      release(cond->guard);
+      leave_critical();
+      return FAILURE;
+    }
+  // the signal cant come between releasing the mutex and waiting, both are under the
+  // guard of the condition variable
+  hand_off(mutex);
+  release(mutex->guard);
+  wait_on(&cond->waiters, &cond->guard, mutex);
+  leave_critical();
+  return SUCCESS;
+}
+
+/***
+ * Moves the first thread waiting on a condition variable to its mutex: it wakes up holding
+ * the mutex if it is free, and waits for it otherwise. Called with the guard of the
+ * condition variable held.
+ * @param cond a condition variable with waiting threads
+ */
+void signal_one(uthread_cond_t *cond)
+{
+  Thread *thread = cond->waiters.pop_front();
+  uthread_mutex_t *mutex = (uthread_mutex_t *) thread->wait_arg;
+  acquire(mutex->guard);
+  if (mutex->owner == NO_OWNER)
+    {
+      mutex->owner = thread->get_id();
+      wake_thread(thread);
+    }
+  else
+    {
+      // a thread terminating it finds the queue by these, under the thread's lock
+      acquire(thread->lock);
+      thread->wait_queue = &mutex->waiters;
+      thread->wait_lock = &mutex->guard;
+      mutex->waiters.push_back(thread);
+      release(thread->lock);
+    }
+  release(mutex->guard);
+}
+
+int uthread_cond_signal(uthread_cond_t *cond)
+{
+  if (cond == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  enter_critical();
+  acquire(cond->guard);
+  if (!cond->waiters.empty())
+    {
+      signal_one(cond);
+    }
+  release(cond->guard);
+  leave_critical();
+  return SUCCESS;
+}
+
+int uthread_cond_broadcast(uthread_cond_t *cond)
+{
+  if (cond == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  enter_critical();
+  acquire(cond->guard);
+  while (!cond->waiters.empty())
+    {
+      signal_one(cond);
+    }
+  release(cond->guard);
+  leave_critical();
+  return SUCCESS;
+}
+
+int uthread_sem_init(uthread_sem_t *sem, int value)
+{
+  if (sem == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  if (value < 0)
+    {
+      cerr << SEM_VALUE_ERROR << endl;
+      return FAILURE;
+    }
+  new(&sem->guard) SpinLock();
+  new(&sem->waiters) ThreadList();
+  sem->value = value;
+  return SUCCESS;
+}
+
+int uthread_sem_wait(uthread_sem_t *sem)
+{
+  if (sem == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  enter_critical();
+  acquire(sem->guard);
+  if (sem->value > 0)
+    {
+      sem->value--;
+      release(sem->guard);
+    }
+  else
+    {
+      // the posting thread hands its unit directly to this thread
+      wait_on(&sem->waiters, &sem->guard, nullptr);
+    }
+  leave_critical();
+  return SUCCESS;
+}
+
+int uthread_sem_trywait(uthread_sem_t *sem)
+{
+  if (sem == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  enter_critical();
+  int ret_val = BUSY;
+  acquire(sem->guard);
+  if (sem->value > 0)
+    {
+      sem->value--;
+      ret_val = SUCCESS;
+    }
+  release(sem->guard);
+  leave_critical();
+  return ret_val;
+}
+
+int uthread_sem_post(uthread_sem_t *sem)
+{
+  if (sem == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  enter_critical();
+  acquire(sem->guard);
+  Thread *next = sem->waiters.pop_front();
+  if (next == nullptr)
+    {
+      sem->value++;
+    }
+  else
+    {
+      wake_thread(next);
+    }
+  release(sem->guard);
+  leave_critical();
+  return SUCCESS;
+}
+
+int uthread_chan_init(uthread_chan_t *chan, int capacity)
+{
+  if (chan == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  if (capacity < 0)
+    {
+      cerr << CAPACITY_ERROR << endl;
+      return FAILURE;
+    }
+  chan->slots = nullptr;
+  if (capacity > 0)
+    {
+      chan->slots = new(nothrow) void *[capacity];
+      if (chan->slots == nullptr)
+        {
+          cerr << BAD_ALLOC << endl;
+          return FAILURE;
+        }
+    }
+  new(&chan->guard) SpinLock();
+  new(&chan->senders) ThreadList();
+  new(&chan->receivers) ThreadList();
+  chan->capacity = capacity;
+  chan->head = 0;
+  chan->count = 0;
+  return SUCCESS;
+}
+
+int uthread_chan_destroy(uthread_chan_t *chan)
+{
+  if (chan == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  enter_critical();
+  acquire(chan->guard);
+  if (!chan->senders.empty() || !chan->receivers.empty())
+    {
+      cerr << CHAN_BUSY_ERROR << endl;
+      release(chan->guard);
+      leave_critical();
+      return FAILURE;
+    }
+  delete[] chan->slots;
+  chan->slots = nullptr;
+  chan->count = 0;
+  release(chan->guard);
+  leave_critical();
+  return SUCCESS;
+}
+
+/***
+ * Adds a value to the end of the ring of a channel that is not full.
+ */
+void chan_push(uthread_chan_t *chan, void *value)
+{
+  chan->slots[(chan->head + chan->count) % chan->capacity] = value;
+  chan->count++;
+}
+
+int uthread_chan_send(uthread_chan_t *chan, void *value)
+{
+  if (chan == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  enter_critical();
+  acquire(chan->guard);
+  // receivers only wait while the ring is empty
+  Thread *receiver = chan->receivers.pop_front();
+  if (receiver != nullptr)
+    {
+      *(void **) receiver->wait_arg = value;
+      wake_thread(receiver);
+    }
+  else if (chan->count < chan->capacity)
+    {
+      chan_push(chan, value);
+    }
+  else
+    {
+      // a receiver takes the value from the waiting thread
+      wait_on(&chan->senders, &chan->guard, value);
+      leave_critical();
+      return SUCCESS;
+    }
+  release(chan->guard);
+  leave_critical();
+  return SUCCESS;
+}
+
+int uthread_chan_recv(uthread_chan_t *chan, void **value)
+{
+  if (chan == nullptr || value == nullptr)
+    {
+      cerr << NULL_OBJECT_ERROR << endl;
+      return FAILURE;
+    }
+  enter_critical();
+  acquire(chan->guard);
+  // senders only wait while the ring is full
+  Thread *sender = chan->senders.pop_front();
+  if (chan->count > 0)
+    {
+      *value = chan->slots[chan->head];
+      chan->head = (chan->head + 1) % chan->capacity;
+      chan->count--;
+      if (sender != nullptr)
+        {
+          chan_push(chan, sender->wait_arg);
+          wake_thread(sender);
+        }
+    }
+  else if (sender != nullptr)
+    {
+      *value = sender->wait_arg;
+      wake_thread(sender);
+    }
+  else
+    {
+      // a sender writes the value through the pointer before waking this thread
+      wait_on(&chan->receivers, &chan->guard, value);
+      leave_critical();
+      return SUCCESS;
+    }
+  release(chan->guard);
+  leave_critical();
+  return SUCCESS;
+}
@@ -0,0 +1,167 @@
+#ifndef _UTHREADS_SYNC_H
+#define _UTHREADS_SYNC_H
+
+/*
+ * Blocking synchronization between the threads of the uthreads library.
+ * A thread that has to wait is queued on the object in the WAITING state and gets no quantums until it is woken up,
+ * and releasing an object hands it directly to the first thread waiting for it, in order of FIFO.
+ * Every object must be initialized before it is used, and must not be copied or moved while threads use it.
+ * A thread that waits may be blocked and resumed like a sleeping thread; terminating it removes it from the queue
+ * (a mutex held by a terminated thread stays locked).
+ * Each object is guarded by a spin lock of its own, so the workers only contend on the objects they share.
+ */
+
+#include "SpinLock.h"
+#include "ThreadList.h"
+
+/* a mutual exclusion lock, not recursive */
+typedef struct {
+  SpinLock guard;
+  ThreadList waiters;
+  int owner; /* the tid of the thread holding the mutex, -1 when it is free */
+} uthread_mutex_t;
+
+/* a condition variable */
+typedef struct {
+  SpinLock guard; /* taken before the guard of the mutex a thread waits with */
+  ThreadList waiters;
+} uthread_cond_t;
+
+/* a counting semaphore */
+typedef struct {
+  SpinLock guard;
+  ThreadList waiters;
+  int value;
+} uthread_sem_t;
+
+/* a bounded multi-producer multi-consumer channel of pointers */
+typedef struct {
+  SpinLock guard;
+  ThreadList senders;
+  ThreadList receivers;
+  void **slots;
+  int capacity;
+  int head;
+  int count;
+} uthread_chan_t;
+
+/**
+ * @brief Initializes a free mutex.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_mutex_init(uthread_mutex_t *mutex);
+
+/**
+ * @brief Locks the mutex, waiting until the thread holding it unlocks it.
+ *
+ * It is an error to lock a mutex the calling thread holds.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_mutex_lock(uthread_mutex_t *mutex);
+
+/**
+ * @brief Locks the mutex if it is free, without waiting.
+ *
+ * @return 0 if the mutex was locked, 1 if another thread holds it, -1 on failure.
+*/
+int uthread_mutex_trylock(uthread_mutex_t *mutex);
+
+/**
+ * @brief Unlocks the mutex, handing it to the first waiting thread if there is one.
+ *
+ * It is an error to unlock a mutex the calling thread does not hold.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_mutex_unlock(uthread_mutex_t *mutex);
+
+/**
+ * @brief Initializes a condition variable.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_cond_init(uthread_cond_t *cond);
+
+/**
+ * @brief Unlocks the mutex and waits on the condition variable, atomically. Returns holding the mutex again.
+ *
+ * A thread woken by uthread_cond_signal is moved straight to the queue of the mutex, so it does not run before it
+ * holds the mutex. It is an error to wait with a mutex the calling thread does not hold.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_cond_wait(uthread_cond_t *cond, uthread_mutex_t *mutex);
+
+/**
+ * @brief Wakes up the first thread waiting on the condition variable, if there is one.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_cond_signal(uthread_cond_t *cond);
+
+/**
+ * @brief Wakes up all the threads waiting on the condition variable.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_cond_broadcast(uthread_cond_t *cond);
+
+/**
+ * @brief Initializes a semaphore with a non-negative value.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_sem_init(uthread_sem_t *sem, int value);
+
+/**
+ * @brief Decrements the semaphore, waiting while its value is 0.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_sem_wait(uthread_sem_t *sem);
+
+/**
+ * @brief Decrements the semaphore if its value is positive, without waiting.
+ *
+ * @return 0 if the semaphore was decremented, 1 if its value is 0, -1 on failure.
+*/
+int uthread_sem_trywait(uthread_sem_t *sem);
+
+/**
+ * @brief Increments the semaphore, or hands the unit directly to the first waiting thread if there is one.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_sem_post(uthread_sem_t *sem);
+
+/**
+ * @brief Initializes a channel that holds up to capacity values. With capacity 0 every send waits for a receive.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_chan_init(uthread_chan_t *chan, int capacity);
+
+/**
+ * @brief Releases the buffer of a channel. It is an error to destroy a channel threads are waiting on.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_chan_destroy(uthread_chan_t *chan);
+
+/**
+ * @brief Sends a value, waiting while the channel is full. A waiting receiver gets the value directly.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_chan_send(uthread_chan_t *chan, void *value);
+
+/**
+ * @brief Receives the oldest value of the channel into *value, waiting while it is empty.
+ *
+ * @return On success, return 0. On failure, return -1.
+*/
+int uthread_chan_recv(uthread_chan_t *chan, void **value);
+
+#endif //_UTHREADS_SYNC_H
@@ -1,4 +1,5 @@
 #include "MapReduceFramework.h"
+#include <algorithm>
 #include <list>
 #include <vector>
 #include <atomic>
@@ -8,9 +9,25 @@
 
 #define BAD_ALLOC "system error: bad memory allocation"
 #define DEFAULT 0
+#define CACHE_LINE 64
+#define STAGES (REDUCE_STAGE + 1)
 
 using namespace std;
 
+/**
+ * the keys of a part of the SHUFFLE stage output, each with all the pairs that have it
+ */
+typedef vector<pair<K2*, IntermediateVec*>> ShuffleVec;
+
+/**
+ * the number of elements a thread processed in each stage, padded to a cache line so the threads do not
+ * write to the same line. every stage has its own count, so a stage starts from zero without a reset
+ */
+typedef struct Progress {
+    atomic<uint64_t> processed[STAGES];
+    char padding[CACHE_LINE - STAGES * sizeof(atomic<uint64_t>)];
+} Progress;
+
 /**
  * a class that includes all the parameters that are relevant for the job.
  */
@@ -19,10 +36,15 @@ class JobContext{
  public:
 
     /**
-     * an atomic 64-bit counter : 2 bits for the stage, 31 bits for the processed and 31 bits for the index
+     * an atomic 64-bit counter : 2 bits for the stage and 62 bits for the index of the next element to claim
      */
     atomic<uint64_t>* counter;
 
+    /**
+     * the progress of each thread in each stage, their sum is the number of elements processed in the stage
+     */
+    vector<Progress> progress;
+
     /**
      * a struct that holds the state of the program and the percentages done
      */
@@ -74,9 +96,25 @@ class JobContext{
     Barrier* barrier;
 
     /**
-     * a vector that is filled in the SHUFFLE stage
+     * the keys each thread samples from its sorted vector for choosing the splitters
+     */
+    vector<vector<K2*>> samples;
+
+    /**
+     * the multi_thread_level - 1 keys that split the keys into the partitions of the SHUFFLE stage,
+     * partition i holds the keys in [splitters[i - 1], splitters[i])
      */
-    vector<pair<K2*,vector<IntermediatePair >*>> *shuffle_vec;
+    vector<K2*> splitters;
+
+    /**
+     * the output of the SHUFFLE stage, thread i fills partition i in the order of the keys
+     */
+    vector<ShuffleVec> partitions;
+
+    /**
+     * the index of the first key of each partition in the SHUFFLE stage output, and the total at the end
+     */
+    vector<unsigned long> partition_starts;
 
     /**
      * number of threads created in the program
@@ -86,12 +124,12 @@ class JobContext{
     /**
      * total number of pairs to process in the SHUFFLE stage
      */
-    int pairs_after_map;
+    unsigned long pairs_after_map;
 
     /**
-     * the size fo the shuffle vector
+     * the number of keys in the SHUFFLE stage output
      */
-    int shuffle_vec_size;
+    unsigned long shuffle_vec_size;
 
     /**
      * a boolean that indicates if a join has been called on the threads
@@ -112,8 +150,8 @@ class JobContext{
      */
     JobContext(int multiThreadLevel, const MapReduceClient& client, JobState *stage, OutputVec& outputVec,
                const InputVec& input_vec, pthread_t* threads):
-    state(stage),client(client), input_vec(input_vec), outputVec(outputVec), threads(threads),
-    multi_thread_level(multiThreadLevel){
+    progress(multiThreadLevel), state(stage),client(client), input_vec(input_vec), outputVec(outputVec),
+    threads(threads), multi_thread_level(multiThreadLevel){
 
       state_mutex = new(nothrow) pthread_mutex_t;
       out_mutex = new(nothrow) pthread_mutex_t;
@@ -121,11 +159,9 @@ class JobContext{
       input_vec_size = input_vec.size();
       counter = new atomic<uint64_t>((unsigned long) DEFAULT);
       barrier = new Barrier(multiThreadLevel);
-      shuffle_vec = new(nothrow) vector<pair<K2*,vector<IntermediatePair >*>>;
-      if (shuffle_vec == nullptr){
-        cerr << BAD_ALLOC <<endl;
-        exit(EXIT_FAILURE);
-      }
+      samples.resize(multiThreadLevel);
+      partitions.resize(multiThreadLevel);
+      partition_starts.resize(multiThreadLevel + 1, DEFAULT);
       pairs_after_map = DEFAULT;
       shuffle_vec_size = DEFAULT;
       joined = false;
@@ -168,10 +204,25 @@ class JobContext{
       delete out_mutex;
       pthread_mutex_destroy(state_mutex);
       delete state_mutex;
+      for (auto v : *threads_vectors){
+        delete v;
+      }
       delete threads_vectors;
-      for (auto v : *shuffle_vec ){
-        delete v.second;
+      for (auto &partition : partitions){
+        for (auto v : partition){
+          delete v.second;
+        }
       }
-      delete shuffle_vec;
+    }
+
+  /**
+   * returns the pairs of a key of the SHUFFLE stage output, counting the keys of the partitions in order
+   *
+   * @param index the index of the key, below shuffle_vec_size
+   */
+  IntermediateVec *shuffle_pairs(unsigned long index) const {
+      unsigned long partition = upper_bound(partition_starts.begin(), partition_starts.end(), index)
+          - partition_starts.begin() - 1;
+      return partitions[partition][index - partition_starts[partition]].second;
     }
 };
\ No newline at end of file
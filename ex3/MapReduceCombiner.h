@@ -0,0 +1,19 @@
+#ifndef MAPREDUCECOMBINER_H
+#define MAPREDUCECOMBINER_H
+#include "MapReduceClient.h"
+
+// a client that can pre-aggregate the intermediate pairs of each thread before the shuffle
+
+class CombinableMapReduceClient : public MapReduceClient {
+public:
+	/**
+	 * called by the framework after the SORT stage, for each key that a thread emitted more than once,
+	 * with all the pairs of the thread that have this key. the function calls emit2 with the combined
+	 * pairs, which must have the same key, and releases the pairs it does not emit again (as reduce does)
+	 * @param pairs the pairs of one key from a thread
+	 * @param context passed to emit2
+	 */
+	virtual void combine(const IntermediateVec* pairs, void* context) const = 0;
+};
+
+#endif //MAPREDUCECOMBINER_H
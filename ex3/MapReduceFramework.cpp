@@ -4,16 +4,18 @@
 #include <iostream>
 #include "JobContext.cpp"
 #include "MapReduceClient.h"
+#include "MapReduceCombiner.h"
 
 #define BAD_CREATION "system error: cannot create thread"
 #define MAP_STATE (1ul << 62)
 #define SHUFFLE_STATE (1ul << 63)
 #define REDUCE_STATE (3ul << 62)
-#define INDEX 0x7FFFFFF
-#define INC_PROCESSED 0x80000000
+#define INDEX ((1ul << 62) - 1)
 #define MAIN_THREAD 0
-#define PROCESSED 0x3FFFFFFF80000000
+#define CHUNK_DIVISOR 4
+#define MAX_CHUNK 1024
 #define PERCENTAGE 100
+#define OVERSAMPLING 8
 
 using namespace std;
 
@@ -36,29 +38,54 @@ bool compare(IntermediatePair &right, IntermediatePair &left) {
 }
 
 /**
- * checks if two IntermediatePair are equal in the keys
- * @param right an IntermediatePair pair
- * @param left another IntermediatePair pair
- * @return True if equal else False
+ * claims the next chunk of elements of the current stage. the chunk is a part of the elements that are left, so the
+ * threads touch the counter rarely while there is a lot of work and still finish together
+ * @param tc the threadContext of each thread
+ * @param counter the atomic counter of the program
+ * @param total the number of elements in the current stage
+ * @param end the end of the chunk
+ * @return the first element of the chunk, total or more if no element is left
+ */
+uint64_t claim_chunk(threadContext *tc, atomic<uint64_t> *counter, uint64_t total, uint64_t *end) {
+  uint64_t claimed = counter->load() & INDEX;
+  uint64_t chunk = 1;
+  if (claimed < total) {
+      chunk = min((uint64_t) MAX_CHUNK,
+                  max((uint64_t) 1, (total - claimed) / (CHUNK_DIVISOR * tc->job->multi_thread_level)));
+    }
+  uint64_t start = counter->fetch_add(chunk) & INDEX;
+  *end = min(start + chunk, total);
+  return start;
+}
+
+/**
+ * counts elements the thread processed in a stage
+ * @param tc the threadContext of each thread
+ * @param stage the stage
+ * @param processed the number of elements
  */
-bool equal(IntermediatePair &right, IntermediatePair &left) {
-  return !(*right.first < *left.first) && !(*left.first < *right.first);
+void add_progress(threadContext *tc, stage_t stage, uint64_t processed) {
+  atomic<uint64_t> &progress = tc->job->progress[tc->thread_id].processed[stage];
+  progress.store(progress.load(memory_order_relaxed) + processed, memory_order_relaxed);  // only this thread writes
 }
 
 /**
- *  handles the map phase. each thread reads pairs of (k1, v1) from the input vector and calls the map function
-    on each of them.
+ *  handles the map phase. each thread claims chunks of pairs of (k1, v1) from the input vector and calls the map
+    function on each of them.
  * @param tc the threadContext of each thread
  * @param counter the atomic counter of the program
  */
 void map_phase(threadContext* tc, atomic<uint64_t>* counter){
   *counter |= MAP_STATE;
-  uint64_t pair_index = ((*(counter))++) & INDEX;
+  uint64_t end;
+  uint64_t pair_index = claim_chunk(tc, counter, tc->job->input_vec_size, &end);
   while (pair_index < tc->job->input_vec_size) {
-      InputPair cur_pair = tc->job->input_vec.at(pair_index);
-      tc->job->client.map(cur_pair.first, cur_pair.second, tc);
-      *counter += INC_PROCESSED;
-      pair_index = ((*counter)++) & (INDEX);
+      for (; pair_index < end; pair_index++) {
+          const InputPair &cur_pair = tc->job->input_vec[pair_index];
+          tc->job->client.map(cur_pair.first, cur_pair.second, tc);
+          add_progress(tc, MAP_STAGE, 1);
+        }
+      pair_index = claim_chunk(tc, counter, tc->job->input_vec_size, &end);
     }
 }
 
@@ -73,92 +100,189 @@ void sort_phase(threadContext* tc){
 }
 
 /**
- * removes empty vectors from the threads_vectors array. also counts the number of pairs produced
+ * handles the combine phase, if the client has a combiner. each thread replaces the pairs of each key in its sorted
+ * vector with the pairs the combiner emits for them, so the vector stays sorted
  * @param tc the threadContext of each thread
- * @return the number of pairs produced
  */
-int remove_empty_vectors(threadContext *tc) {
-  int total_pairs = 0;
-  for (int pos = tc->job->threads_vectors->size() - 1; pos >= 0; pos--) {
-      if (tc->job->threads_vectors->at(pos)->empty()) {
-          delete tc->job->threads_vectors->at(pos);
-          tc->job->threads_vectors->erase(tc->job->threads_vectors->begin() + pos);
-          continue;
+void combine_phase(threadContext *tc) {
+  auto *combiner = dynamic_cast<const CombinableMapReduceClient *>(&tc->job->client);
+  if (combiner == nullptr) {
+      return;
+    }
+  IntermediateVec *cur_vec = tc->job->threads_vectors->at(tc->thread_id);
+  auto *combined = new(nothrow) IntermediateVec;
+  if (combined == nullptr){
+      cerr << BAD_ALLOC << endl;
+      exit(EXIT_FAILURE);
+    }
+  tc->job->threads_vectors->at(tc->thread_id) = combined;           //emit2 of the combiner fills it
+  IntermediateVec group;
+  for (auto pair = cur_vec->begin(); pair != cur_vec->end();) {
+      auto group_end = pair + 1;
+      while (group_end != cur_vec->end() && !(*pair->first < *group_end->first)) {
+          ++group_end;
+        }
+      if (group_end - pair == 1) {
+          combined->push_back(*pair);
+        } else {
+          group.assign(pair, group_end);
+          combiner->combine(&group, tc);
         }
-      total_pairs += tc->job->threads_vectors->at(pos)->size();
+      pair = group_end;
+    }
+  delete cur_vec;
+}
+
+/**
+ * compares between two keys
+ * @param right a key
+ * @param left another key
+ * @return True if left bigger than right else False
+ */
+bool compare_keys(K2 *right, K2 *left) {
+  return *right < *left;
+}
+
+/**
+ * takes evenly spaced keys from the sorted vector of the thread as its samples for choosing the splitters
+ * @param tc the threadContext of each thread
+ */
+void sample_phase(threadContext *tc) {
+  IntermediateVec *cur_vec = tc->job->threads_vectors->at(tc->thread_id);
+  vector<K2 *> &samples = tc->job->samples.at(tc->thread_id);
+  size_t num_samples = min(cur_vec->size(), (size_t) OVERSAMPLING * tc->job->multi_thread_level);
+  for (size_t sample = 0; sample < num_samples; sample++) {
+      samples.push_back(cur_vec->at(sample * cur_vec->size() / num_samples).first);
+    }
+}
+
+/**
+ * chooses the splitters from the samples of all the threads, so that every partition gets about the same number
+ * of pairs. also counts the number of pairs produced
+ * @param tc the threadContext of each thread
+ * @return the number of pairs produced
+ */
+unsigned long choose_splitters(threadContext *tc) {
+  unsigned long total_pairs = 0;
+  vector<K2 *> all_samples;
+  for (int thread = 0; thread < tc->job->multi_thread_level; thread++) {
+      total_pairs += tc->job->threads_vectors->at(thread)->size();
+      all_samples.insert(all_samples.end(), tc->job->samples[thread].begin(), tc->job->samples[thread].end());
+    }
+  if (all_samples.empty()) {
+      return total_pairs;
+    }
+  sort(all_samples.begin(), all_samples.end(), compare_keys);
+  for (int partition = 1; partition < tc->job->multi_thread_level; partition++) {
+      tc->job->splitters.push_back(all_samples[partition * all_samples.size() / tc->job->multi_thread_level]);
     }
   return total_pairs;
 }
 
 /**
- * searches for the max key from the last element in each thread vector
-  * @param tc the threadContext of each thread
- * @return the max pair
+ * finds where a partition starts in a sorted vector. the pairs with a key equal to a splitter are all in the
+ * partition that starts with it, so a key is never split between two partitions
+ * @param job the JobContext
+ * @param vec a sorted intermediate vector
+ * @param partition the partition, multi_thread_level for the end of the vector
+ * @return the position of the first pair of the partition
  */
-IntermediatePair get_max_pair(threadContext *tc) {
-  int max_vec = 0;
-  for (int pair = 1; pair <= tc->job->threads_vectors->size() - 1; pair++) {
-      if (compare(tc->job->threads_vectors->at(max_vec)->back(), tc->job->threads_vectors->at(pair)->back())) {
-          max_vec = pair;
-        }
+IntermediateVec::iterator partition_start(JobContext *job, IntermediateVec *vec, int partition) {
+  if (partition == 0) {
+      return vec->begin();
     }
-  IntermediatePair max_pair = tc->job->threads_vectors->at(max_vec)->back();
-  tc->job->threads_vectors->at(max_vec)->pop_back();
-  if (tc->job->threads_vectors->at(max_vec)->empty()) {
-      delete tc->job->threads_vectors->at(max_vec);
-      tc->job->threads_vectors->erase(tc->job->threads_vectors->begin() + max_vec);
+  if (partition == job->multi_thread_level || job->splitters.empty()) {
+      return vec->end();
     }
-  return max_pair;
+  return lower_bound(vec->begin(), vec->end(), job->splitters[partition - 1],
+                     [](const IntermediatePair &pair, K2 *key) { return *pair.first < *key; });
+}
+
+/**
+ * a range of pairs sorted by their keys
+ */
+typedef pair<IntermediateVec::iterator, IntermediateVec::iterator> Run;
+
+/**
+ * orders runs in a heap so the run with the min first key is on top
+ * @param right a run
+ * @param left another run
+ * @return True if the first key of right is bigger than the first key of left
+ */
+bool later_run(const Run &right, const Run &left) {
+  return *left.first->first < *right.first->first;
 }
 
 /**
- * creates a new vector of (k2, v2) where in each sequence all keys are identical and all elements with a given key
- * are in a single sequence
+ * creates the partition of the thread in the SHUFFLE stage output: a k-way merge of the thread's partition of
+ * every sorted vector, where all the pairs with a given key are in a single sequence
  *
  * @param tc the threadContext of each thread
  * @param counter the atomic counter of the program
  */
 void shuffle_phase(threadContext *tc, atomic<uint64_t> *counter) {
-  *counter = SHUFFLE_STATE;
-  tc->job->pairs_after_map = remove_empty_vectors(tc);            //remove empty vectors and count the number of pairs
-  while (!tc->job->threads_vectors->empty()) {
-      IntermediatePair max_pair = get_max_pair(tc);
-      *counter += (INC_PROCESSED);
+  vector<Run> runs;
+  for (IntermediateVec *vec : *tc->job->threads_vectors) {
+      Run run(partition_start(tc->job, vec, tc->thread_id), partition_start(tc->job, vec, tc->thread_id + 1));
+      if (run.first != run.second) {
+          runs.push_back(run);
+        }
+    }
+  make_heap(runs.begin(), runs.end(), later_run);
+  ShuffleVec &partition = tc->job->partitions.at(tc->thread_id);
+  while (!runs.empty()) {
+      K2 *key = runs.front().first->first;
       auto *val_vec = new(nothrow) vector<IntermediatePair>;
       if (val_vec == nullptr){
           cerr << BAD_ALLOC << endl;
           exit(EXIT_FAILURE);
         }
-      val_vec->push_back(max_pair);
-      for (int pair = tc->job->threads_vectors->size() - 1 ; pair >= 0; pair--) {
-          while((equal(max_pair,tc->job->threads_vectors->at(pair)->back()))) {
-              val_vec->push_back(tc->job->threads_vectors->at(pair)->back());
-              tc->job->threads_vectors->at(pair)->pop_back();
-              *counter += (INC_PROCESSED);
-              if (tc->job->threads_vectors->at(pair)->empty()) {
-                  delete tc->job->threads_vectors->at(pair);
-                  tc->job->threads_vectors->erase(tc->job->threads_vectors->begin() + pair);
-                  break;
-                }
+      while (!runs.empty() && !(*key < *runs.front().first->first)) {      //the runs that have the key are on top
+          pop_heap(runs.begin(), runs.end(), later_run);
+          Run &run = runs.back();
+          while (run.first != run.second && !(*key < *run.first->first)) {
+              val_vec->push_back(*run.first);
+              ++run.first;
+            }
+          if (run.first == run.second) {
+              runs.pop_back();
+            } else {
+              push_heap(runs.begin(), runs.end(), later_run);
             }
         }
-      tc->job->shuffle_vec->push_back(make_pair(max_pair.first,val_vec));
+      add_progress(tc, SHUFFLE_STAGE, val_vec->size());
+      partition.push_back(make_pair(key, val_vec));
     }
 }
 
 /**
- * handles the reduce phase. each thread reads pairs of (k2, vector<k2,v2>) from the shuffle vector and calls the
- * reduce function on each of them.
+ * sets where each partition starts in the SHUFFLE stage output
+ * @param tc the threadContext of each thread
+ * @return the number of keys in the SHUFFLE stage output
+ */
+unsigned long count_keys(threadContext *tc) {
+  for (int partition = 0; partition < tc->job->multi_thread_level; partition++) {
+      tc->job->partition_starts[partition + 1] =
+          tc->job->partition_starts[partition] + tc->job->partitions[partition].size();
+    }
+  return tc->job->partition_starts.back();
+}
+
+/**
+ * handles the reduce phase. each thread claims chunks of pairs of (k2, vector<k2,v2>) from the shuffle output and
+ * calls the reduce function on each of them.
  * @param tc the threadContext of each thread
  * @param counter the atomic counter of the program
  */
 void reduce_phase(threadContext *tc, atomic<uint64_t> *counter) {
-  uint64_t pair_index = ((*(counter))++) & (INDEX);
+  uint64_t end;
+  uint64_t pair_index = claim_chunk(tc, counter, tc->job->shuffle_vec_size, &end);
   while (pair_index < tc->job->shuffle_vec_size) {
-      auto cur_pair = tc->job->shuffle_vec->at(pair_index);
-      tc->job->client.reduce(cur_pair.second, tc);
-      *counter += (INC_PROCESSED);
-      pair_index = ((*counter)++) & (INDEX);
+      for (; pair_index < end; pair_index++) {
+          tc->job->client.reduce(tc->job->shuffle_pairs(pair_index), tc);
+          add_progress(tc, REDUCE_STAGE, 1);
+        }
+      pair_index = claim_chunk(tc, counter, tc->job->shuffle_vec_size, &end);
     }
 }
 
@@ -175,11 +299,22 @@ void *thread_job(void *arg) {
   map_phase(tc, counter);
   ////SORT phase
   sort_phase(tc);
+  ////COMBINE phase
+  combine_phase(tc);
+  sample_phase(tc);
   tc->job->barrier->barrier();
   ////SHUFFLE phase
   if (tc->thread_id == MAIN_THREAD) {
-      shuffle_phase(tc, counter);
-      tc->job->shuffle_vec_size = tc->job->shuffle_vec->size();
+      tc->job->pairs_after_map = choose_splitters(tc);
+      *counter = SHUFFLE_STATE;
+    }
+  tc->job->barrier->barrier();
+  shuffle_phase(tc, counter);
+  tc->job->barrier->barrier();
+  delete tc->job->threads_vectors->at(tc->thread_id);           //every partition of it is merged
+  tc->job->threads_vectors->at(tc->thread_id) = nullptr;
+  if (tc->thread_id == MAIN_THREAD) {
+      tc->job->shuffle_vec_size = count_keys(tc);
       *counter = REDUCE_STATE;
     }
   tc->job->barrier->barrier();
@@ -213,8 +348,11 @@ void getJobState(JobHandle job, JobState *state) {
   auto *cur_job = (JobContext *) job;
   pthread_mutex_lock(cur_job->state_mutex);
   unsigned long counter = (cur_job->counter->load());
-  int processed = (counter & PROCESSED) >> 31; // taking the 31 in thr middle
   stage_t stage = static_cast<stage_t>(counter >> 62);
+  unsigned long processed = 0;                // the counts of a stage only grow, even after it ended
+  for (Progress &progress : cur_job->progress) {
+      processed += progress.processed[stage];
+    }
   unsigned long total = 0;
   if (stage == UNDEFINED_STAGE){
       state->percentage = cur_job->state->percentage = 0;